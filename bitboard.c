@@ -0,0 +1,232 @@
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BB_X86 1
+#endif
+#include "bitboard.h"
+
+/* Shifts in the same order as ALLDIRECTIONS in the mailbox board */
+static const int SHIFTS[8] = {-9, -8, -7, -1, 1, 7, 8, 9};
+
+/* Masks applied after each shift so that a line cannot wrap around an edge */
+static const uint64_t MASKS[8] = {
+	0x7f7f7f7f7f7f7f7fULL, 0xffffffffffffffffULL, 0xfefefefefefefefeULL, 0x7f7f7f7f7f7f7f7fULL,
+	0xfefefefefefefefeULL, 0x7f7f7f7f7f7f7f7fULL, 0xffffffffffffffffULL, 0xfefefefefefefefeULL};
+
+static inline uint64_t shift(uint64_t b, int dir)
+{
+	if (SHIFTS[dir] > 0)
+		return (b << SHIFTS[dir]) & MASKS[dir];
+	else
+		return (b >> -SHIFTS[dir]) & MASKS[dir];
+}
+
+/* The opponent discs a run can go through sideways or diagonally without wrapping round an edge */
+#define INNER_COLUMNS 0x7e7e7e7e7e7e7e7eULL
+
+/*
+ * Each direction is filled through runs of opponent discs (at most six
+ * in a row) and the square just past a run is a move if it is empty.
+ */
+static uint64_t moves_scalar(uint64_t own, uint64_t opp)
+{
+	uint64_t empty = ~(own | opp);
+	uint64_t moves = 0;
+	uint64_t run;
+	int dir;
+
+	for (dir = 0; dir < 8; dir++)
+	{
+		run = shift(own, dir) & opp;
+		run |= shift(run, dir) & opp;
+		run |= shift(run, dir) & opp;
+		run |= shift(run, dir) & opp;
+		run |= shift(run, dir) & opp;
+		run |= shift(run, dir) & opp;
+		moves |= shift(run, dir) & empty;
+	}
+	return moves;
+}
+
+#ifdef BB_X86
+/*
+ * The AVX2 version fills runs by Kogge-Stone doubling: two steps of one
+ * square, then two of two squares through pairs of opponent discs, reach
+ * the six a run can have. Sideways and diagonal runs only go through the
+ * opponent discs off the edge columns, so shifts need no masks.
+ */
+
+/* The four directions of a shift in the four lanes, shifted left and right */
+__attribute__((target("avx2"))) static uint64_t moves_avx2(uint64_t own, uint64_t opp)
+{
+	const __m256i shifts = _mm256_set_epi64x(9, 7, 8, 1);
+	const __m256i doubled = _mm256_set_epi64x(18, 14, 16, 2);
+	const __m256i masks = _mm256_set_epi64x(INNER_COLUMNS, INNER_COLUMNS, -1, INNER_COLUMNS);
+	__m256i p = _mm256_set1_epi64x(own);
+	__m256i o = _mm256_and_si256(_mm256_set1_epi64x(opp), masks);
+	__m256i left, right, pre_left, pre_right, all;
+	__m128i half;
+
+	left = _mm256_and_si256(o, _mm256_sllv_epi64(p, shifts));
+	right = _mm256_and_si256(o, _mm256_srlv_epi64(p, shifts));
+	left = _mm256_or_si256(left, _mm256_and_si256(o, _mm256_sllv_epi64(left, shifts)));
+	right = _mm256_or_si256(right, _mm256_and_si256(o, _mm256_srlv_epi64(right, shifts)));
+	pre_left = _mm256_and_si256(o, _mm256_sllv_epi64(o, shifts));
+	pre_right = _mm256_and_si256(o, _mm256_srlv_epi64(o, shifts));
+	left = _mm256_or_si256(left, _mm256_and_si256(pre_left, _mm256_sllv_epi64(left, doubled)));
+	right = _mm256_or_si256(right, _mm256_and_si256(pre_right, _mm256_srlv_epi64(right, doubled)));
+	left = _mm256_or_si256(left, _mm256_and_si256(pre_left, _mm256_sllv_epi64(left, doubled)));
+	right = _mm256_or_si256(right, _mm256_and_si256(pre_right, _mm256_srlv_epi64(right, doubled)));
+	all = _mm256_or_si256(_mm256_sllv_epi64(left, shifts), _mm256_srlv_epi64(right, shifts));
+
+	half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+	half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+	return (uint64_t)_mm_cvtsi128_si64(half) & ~(own | opp);
+}
+#endif
+
+/*
+ * The first call picks the version this CPU can run, every call after
+ * that goes straight to it. The pointer is only read and written with
+ * atomics, as the helper threads of a rank may make the first call
+ * along with its main thread; they all pick the same version, and
+ * relaxed order is enough as the code it points to never changes.
+ */
+static uint64_t moves_resolve(uint64_t own, uint64_t opp);
+static uint64_t (*moves_impl)(uint64_t, uint64_t) = moves_resolve;
+
+static uint64_t (*resolve())(uint64_t, uint64_t)
+{
+	uint64_t (*impl)(uint64_t, uint64_t) = moves_scalar;
+#ifdef BB_X86
+	if (__builtin_cpu_supports("avx2"))
+		impl = moves_avx2;
+#endif
+	__atomic_store_n(&moves_impl, impl, __ATOMIC_RELAXED);
+	return impl;
+}
+
+static uint64_t moves_resolve(uint64_t own, uint64_t opp)
+{
+	return resolve()(own, opp);
+}
+
+/**
+ * Returns the set of squares on which the player owning `own` may play,
+ * with AVX2 where the CPU has it.
+ */
+uint64_t bb_moves(uint64_t own, uint64_t opp)
+{
+	return __atomic_load_n(&moves_impl, __ATOMIC_RELAXED)(own, opp);
+}
+
+/* Names the version of bb_moves in use */
+const char *bb_backend()
+{
+	uint64_t (*impl)(uint64_t, uint64_t) = __atomic_load_n(&moves_impl, __ATOMIC_RELAXED);
+
+	if (impl == moves_resolve)
+		impl = resolve();
+	return impl == moves_scalar ? "scalar" : "avx2";
+}
+
+/**
+ * Returns the opponent discs flipped by playing on `bit`, or 0 if the
+ * move is not legal.
+ */
+uint64_t bb_flips(int bit, uint64_t own, uint64_t opp)
+{
+	uint64_t flips = 0;
+	uint64_t line, x;
+	int dir;
+
+	for (dir = 0; dir < 8; dir++)
+	{
+		line = 0;
+		x = shift(BB_BIT(bit), dir);
+		while (x & opp)
+		{
+			line |= x;
+			x = shift(x, dir);
+		}
+		if (x & own)
+			flips |= line;
+	}
+	return flips;
+}
+
+static uint64_t mirror_columns(uint64_t x)
+{
+	x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+	return x;
+}
+
+static uint64_t transpose(uint64_t x)
+{
+	uint64_t t;
+	t = 0x0f0f0f0f00000000ULL & (x ^ (x << 28));
+	x ^= t ^ (t >> 28);
+	t = 0x3333000033330000ULL & (x ^ (x << 14));
+	x ^= t ^ (t >> 14);
+	t = 0x5500550055005500ULL & (x ^ (x << 7));
+	x ^= t ^ (t >> 7);
+	return x;
+}
+
+/**
+ * Applies one of the eight symmetries to a bitboard: bit 0 of symmetry
+ * mirrors the columns, bit 1 the rows and bit 2 then swaps rows and columns.
+ */
+uint64_t bb_transform(uint64_t b, int symmetry)
+{
+	if (symmetry & 1)
+		b = mirror_columns(b);
+	if (symmetry & 2)
+		b = __builtin_bswap64(b);
+	if (symmetry & 4)
+		b = transpose(b);
+	return b;
+}
+
+/**
+ * Undoes bb_transform with the same symmetry, each step being its own
+ * inverse.
+ */
+uint64_t bb_untransform(uint64_t b, int symmetry)
+{
+	if (symmetry & 4)
+		b = transpose(b);
+	if (symmetry & 2)
+		b = __builtin_bswap64(b);
+	if (symmetry & 1)
+		b = mirror_columns(b);
+	return b;
+}
+
+/**
+ * Replaces a pair of bitboards by the smallest of its eight images, first
+ * compared first, and returns the symmetry that gives it. Positions that
+ * are mirror images of each other have the same canonical form.
+ */
+int bb_canonical(uint64_t *first, uint64_t *second)
+{
+	uint64_t best_first = *first, best_second = *second, f, s;
+	int symmetry, best = 0;
+
+	for (symmetry = 1; symmetry < 8; symmetry++)
+	{
+		f = bb_transform(*first, symmetry);
+		s = bb_transform(*second, symmetry);
+		if (f < best_first || (f == best_first && s < best_second))
+		{
+			best = symmetry;
+			best_first = f;
+			best_second = s;
+		}
+	}
+	*first = best_first;
+	*second = best_second;
+	return best;
+}
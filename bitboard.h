@@ -0,0 +1,47 @@
+#ifndef _BITBOARD_H
+#define _BITBOARD_H
+
+#include <stdint.h>
+
+/*
+ * Bit i of a bitboard is row i / 8, column i % 8 of the board, counting
+ * from the top left corner, so bit order matches the 11..88 square order
+ * of the 10x10 mailbox used by the rest of the engine.
+ */
+
+#define BB_SQUARES 64
+
+#define BB_BIT(bit) (1ULL << (bit))
+
+uint64_t bb_moves(uint64_t own, uint64_t opp);
+const char *bb_backend();
+uint64_t bb_flips(int bit, uint64_t own, uint64_t opp);
+
+uint64_t bb_transform(uint64_t b, int symmetry);
+uint64_t bb_untransform(uint64_t b, int symmetry);
+int bb_canonical(uint64_t *first, uint64_t *second);
+
+static inline int bb_count(uint64_t b)
+{
+	return __builtin_popcountll(b);
+}
+
+/* Lowest set bit of a non-empty bitboard */
+static inline int bb_first(uint64_t b)
+{
+	return __builtin_ctzll(b);
+}
+
+/* Bit index to square of the 10x10 mailbox board */
+static inline int bb_to_square(int bit)
+{
+	return 10 * (bit / 8 + 1) + bit % 8 + 1;
+}
+
+/* Square of the 10x10 mailbox board to bit index */
+static inline int bb_from_square(int square)
+{
+	return 8 * (square / 10 - 1) + square % 10 - 1;
+}
+
+#endif
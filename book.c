@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "comms.h"
+#include "bitboard.h"
+#include "book.h"
+
+static void *mapping;
+static size_t mapping_size;
+static const book_record *records;
+static uint64_t record_count;
+
+/* splitmix64 finaliser */
+static uint64_t mix(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Finds the symmetry that maps own and opp to their canonical form (see
+ * bb_canonical), stores the key of that pair and returns the symmetry.
+ */
+int book_canonical(uint64_t own, uint64_t opp, uint64_t *key)
+{
+	int symmetry = bb_canonical(&own, &opp);
+
+	*key = mix(own ^ mix(opp));
+	return symmetry;
+}
+
+/**
+ * Maps a book file into memory for the rest of the game
+ */
+int book_open(const char *path)
+{
+	struct stat st;
+	const char *base;
+	uint32_t version;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return FAILURE;
+	if (fstat(fd, &st) != 0 || st.st_size < 16)
+	{
+		close(fd);
+		return FAILURE;
+	}
+	mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		mapping = NULL;
+		return FAILURE;
+	}
+	mapping_size = st.st_size;
+
+	base = (const char *)mapping;
+	memcpy(&version, base + 4, sizeof(version));
+	memcpy(&record_count, base + 8, sizeof(record_count));
+	if (memcmp(base, "SBOK", 4) != 0 || version != 1 ||
+		record_count != (mapping_size - 16) / sizeof(book_record) ||
+		(mapping_size - 16) % sizeof(book_record) != 0)
+	{
+		book_close();
+		return FAILURE;
+	}
+	records = (const book_record *)(base + 16);
+	return SUCCESS;
+}
+
+void book_close()
+{
+	if (mapping != NULL)
+		munmap(mapping, mapping_size);
+	mapping = NULL;
+	records = NULL;
+	record_count = 0;
+}
+
+/**
+ * Returns the book move for the side owning own as a bit index, or -1 if
+ * the position is not in the book or its move is not legal here.
+ */
+int book_probe(uint64_t own, uint64_t opp)
+{
+	uint64_t key, low, high, mid, move;
+	int symmetry;
+
+	if (records == NULL)
+		return -1;
+	symmetry = book_canonical(own, opp, &key);
+
+	low = 0;
+	high = record_count;
+	while (low < high)
+	{
+		mid = low + (high - low) / 2;
+		if (records[mid].key < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == record_count || records[low].key != key)
+		return -1;
+
+	// The stored move is on the canonical board, so it is matched against the legal moves seen the same way
+	for (move = bb_moves(own, opp); move; move &= move - 1)
+	{
+		if (bb_transform(move & -move, symmetry) == BB_BIT(records[low].move))
+			return bb_first(move);
+	}
+	return -1;
+}
@@ -0,0 +1,29 @@
+#ifndef _BOOK_H
+#define _BOOK_H
+
+#include <stdint.h>
+
+/*
+ * Opening book: a file of fixed records sorted by key, mapped into memory
+ * and searched by bisection. Positions are stored from the point of view
+ * of the side to move and reduced over the eight symmetries of the board,
+ * so a line is found whichever way round the board it is played.
+ *
+ * The file is the four bytes "SBOK", a uint32 version (1) and a uint64
+ * record count, then the records, all in the byte order of the machine.
+ */
+
+typedef struct book_record
+{
+	uint64_t key;
+	uint8_t move; /* bit index of the move, on the board in canonical orientation */
+	uint8_t reserved[7];
+} book_record;
+
+int book_canonical(uint64_t own, uint64_t opp, uint64_t *key);
+
+int book_open(const char *path);
+void book_close();
+int book_probe(uint64_t own, uint64_t opp);
+
+#endif
@@ -1,120 +1,336 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include "comms.h" 
 
-const int LENBUFSIZE=3;
-const int MSGBUFSIZE=100;
+/* Every frame from the server is a 2 digit body length and then the body */
+const int LENBUFSIZE=2;
 
-int comms_get_colour(int* my_colour);
+/* Size of the receive ring, a power of two with room for more than one whole frame */
+#define RINGSIZE 256
 
-static int socket_desc;
+/*
+ * A connection to the server. Bytes received but not read yet are
+ * ring[head % RINGSIZE] up to ring[tail % RINGSIZE]; both only ever count
+ * up, so tail - head is how many there are. A recv may end anywhere in a
+ * frame or take in several. A connection opened by comms_connect is
+ * connecting until comms_get_colour has read its colour.
+ */
+typedef struct connection {
+	int open;
+	int connecting;
+	int socket_desc;
+	char ring[RINGSIZE];
+	unsigned int ring_head;
+	unsigned int ring_tail;
+} connection;
+
+/* Every call works on the selected connection, the first one unless comms_select picks another */
+static connection connections[MAXCONNECTIONS];
+static connection *conn = &connections[0];
+
+/**
+ * Receives whatever the server has sent into the free part of the ring,
+ * waiting until there is something. Fails if the socket is closed.
+ */
+static int ring_fill() {
+	unsigned int used = conn->ring_tail - conn->ring_head;
+	unsigned int at = conn->ring_tail % RINGSIZE;
+	size_t room = RINGSIZE - at;
+	ssize_t n;
+
+	if (room > RINGSIZE - used) room = RINGSIZE - used;
+	do {
+		n = recv(conn->socket_desc, &conn->ring[at], room, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0) {
+		#ifdef DEBUG
+		printf("Comms error: Could not receive from server\n");
+		#endif
+		return FAILURE;
+	}
+	conn->ring_tail += n;
+	return SUCCESS;
+}
+
+static char ring_at(unsigned int i) {
+	return conn->ring[i % RINGSIZE];
+}
+
+/**
+ * Returns the length of the body of the frame at the head of the ring, or
+ * -1 if its length has not arrived yet
+ */
+static int frame_length() {
+	int len = 0;
+	unsigned int i;
+	char c;
+
+	if (conn->ring_tail - conn->ring_head < (unsigned int)LENBUFSIZE) return -1;
+	for (i = 0; i < (unsigned int)LENBUFSIZE; i++) {
+		c = ring_at(conn->ring_head + i);
+		if (c >= '0' && c <= '9') len = 10 * len + c - '0';
+	}
+	return len;
+}
+
+/* TRUE once the whole frame at the head of the ring has arrived */
+static int frame_ready() {
+	int len = frame_length();
+	return len >= 0 && conn->ring_tail - conn->ring_head >= (unsigned int)(LENBUFSIZE + len);
+}
+
+/**
+ * Copies the word at ring[*at] up to end into word, at most size - 1
+ * characters of it, and moves *at past it and the spaces before it
+ */
+static int read_word(unsigned int *at, unsigned int end, char word[], int size) {
+	int n = 0;
+
+	while (*at != end && ring_at(*at) == ' ') (*at)++;
+	if (*at == end) return 0;
+	while (*at != end && ring_at(*at) != ' ') {
+		if (n < size - 1) word[n++] = ring_at(*at);
+		(*at)++;
+	}
+	word[n] = '\0';
+	return 1;
+}
 
 /**
- * Creates socket, connects to remote server, and calls comms_get_colour 
+ * Creates socket, connects to remote server, and calls comms_get_colour.
+ * The socket is the selected connection; one it had before must have
+ * been closed with comms_close
  */
 int comms_init_network(int* my_colour, unsigned long ip, int port) {
 	struct sockaddr_in server;
+	int nodelay = 1;
 
 	/* Create socket */
-	socket_desc = socket(AF_INET, SOCK_STREAM, 0);
-	if (socket_desc == -1) {
+	conn->socket_desc = socket(AF_INET, SOCK_STREAM, 0);
+	if (conn->socket_desc == -1) {
 		#ifdef DEBUG
 		printf("Comms error: Could not create socket\n"); 
 		#endif
 		return FAILURE;
 	}
+	conn->open = 1;
 
 	server.sin_addr.s_addr = ip;
 	server.sin_family = AF_INET;
 	server.sin_port = htons(port);
 
 	/* Connect to remote server */
-	if (connect(socket_desc, (struct sockaddr *)&server, sizeof(server)) < 0){
+	if (connect(conn->socket_desc, (struct sockaddr *)&server, sizeof(server)) < 0){
 		#ifdef DEBUG
 		printf("Comms error: Could not connect to server\n"); 
 		#endif
+		comms_close();
 		return FAILURE;
 	}
 
+	/* Moves are tiny, they should go out at once rather than wait to be coalesced */
+	setsockopt(conn->socket_desc, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	conn->ring_head = conn->ring_tail = 0;
+
 	return comms_get_colour(my_colour);
 }
 
 /**
- * Creates socket, connects to remote server, and calls comms_get_colour 
+ * Starts connecting the selected connection to the server without waiting
+ * for it. comms_ready reports the connection once its colour has come or
+ * the connect has failed, and comms_get_colour then tells which. One it
+ * had before must have been closed with comms_close
+ */
+int comms_connect(unsigned long ip, int port) {
+	struct sockaddr_in server;
+	int flags;
+
+	conn->socket_desc = socket(AF_INET, SOCK_STREAM, 0);
+	if (conn->socket_desc == -1) {
+		#ifdef DEBUG
+		printf("Comms error: Could not create socket\n");
+		#endif
+		return FAILURE;
+	}
+	conn->open = 1;
+	conn->ring_head = conn->ring_tail = 0;
+	flags = fcntl(conn->socket_desc, F_GETFL, 0);
+	fcntl(conn->socket_desc, F_SETFL, flags | O_NONBLOCK);
+
+	server.sin_addr.s_addr = ip;
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+
+	if (connect(conn->socket_desc, (struct sockaddr *)&server, sizeof(server)) < 0 && errno != EINPROGRESS) {
+		#ifdef DEBUG
+		printf("Comms error: Could not connect to server\n");
+		#endif
+		comms_close();
+		return FAILURE;
+	}
+	conn->connecting = 1;
+	return SUCCESS;
+}
+
+/**
+ * Finishes a connect started by comms_connect, once comms_ready has
+ * reported it: fails if it did not go through, and otherwise makes the
+ * socket blocking again like one from comms_init_network
+ */
+static int finish_connect() {
+	int error = 0, nodelay = 1, flags;
+	socklen_t len = sizeof(error);
+
+	conn->connecting = 0;
+	if (getsockopt(conn->socket_desc, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+		#ifdef DEBUG
+		printf("Comms error: Could not connect to server\n");
+		#endif
+		return FAILURE;
+	}
+	flags = fcntl(conn->socket_desc, F_GETFL, 0);
+	fcntl(conn->socket_desc, F_SETFL, flags & ~O_NONBLOCK);
+	setsockopt(conn->socket_desc, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	return SUCCESS;
+}
+
+/**
+ * Receives the colour, a single digit sent before the first frame. On a
+ * connection from comms_connect, only once comms_ready has reported it
  */
 int comms_get_colour(int* my_colour) {
-	char tempColour[2]; tempColour[1] = 0;
-	if(recv(socket_desc, tempColour , 1, 0) < 0){
+	if (conn->connecting && finish_connect() == FAILURE) return FAILURE;
+	if (conn->ring_tail == conn->ring_head && ring_fill() == FAILURE) {
 		#ifdef DEBUG
 		printf("Comms error: Could not receive colour\n");
 		#endif
 		return FAILURE;
 	}
-	*my_colour = atoi(tempColour);
+	*my_colour = ring_at(conn->ring_head++) - '0';
 	return SUCCESS;
 }
 
 /**
  * Receives message from server, which includes a cmd 
- * and, if cmd == play_move, also the opponent's move 
+ * and, if cmd == play_move, also the opponent's move.
+ * The words are read straight out of the ring, nothing is allocated
  */
 int comms_get_cmd(char cmd[], char move[]) {
-	int result = SUCCESS;
-	int msg_len;
+	unsigned int at, end;
+
+	while (!frame_ready()) {
+		if (ring_fill() == FAILURE) return FAILURE;
+	}
+	at = conn->ring_head + LENBUFSIZE;
+	end = at + frame_length();
 
-	char* tmp_cmd;
-	char* tmp_move;
+	cmd[0] = '\0';
+	read_word(&at, end, cmd, CMDBUFSIZE);
+	read_word(&at, end, move, MOVEBUFSIZE);
 
-	char* len_buf = malloc(LENBUFSIZE*sizeof(char));
-	char* msg_buf = malloc(MSGBUFSIZE*sizeof(char)); 
+	conn->ring_head = end;
+	return SUCCESS;
+}
 
-	memset(len_buf, 0, LENBUFSIZE);
-	memset(msg_buf, 0, MSGBUFSIZE);
+/**
+ * Sends a message to the server, which includes my_move 
+ * and, if cmd == play_move, also the opponent's move 
+ */
+int comms_send_move(char my_move[]) {
 
-	if (recv(socket_desc, len_buf , 2, 0) < 0){
-		result = FAILURE;
-	} else {
+	if (send(conn->socket_desc, my_move, strlen(my_move) , 0) < 0) {
+		return FAILURE;
+	}
 
-		msg_len = atoi(len_buf);
-	
-		if (recv(socket_desc, msg_buf, msg_len, 0) < 0){
-			result = FAILURE; 
-		} else {
+	return SUCCESS;
+}
 
-			msg_buf[msg_len] = '\0';
+/**
+ * Waits up to timeout_ms milliseconds (0 to just look) for the server 
+ * to send something, returns 1 if a cmd can be read without blocking 
+ */
+int comms_cmd_waiting(int timeout_ms) {
+	struct pollfd pfd;
 
-			//strok is a dangerous command: 
-			//- modifies argument
-			//- returns a ptr into argument 
-			//- maintains state, which is not thread-state  
-			tmp_cmd = strtok(msg_buf, " ");  //get ptr to cmd in msg_buf; 
-			tmp_move = strtok(NULL, " ");	//get ptr to move in msg_buf
+	/* A frame may already be waiting in the ring, read along with the last one */
+	if (frame_ready()) {
+		return 1;
+	}
 
-			strncpy(cmd, tmp_cmd, CMDBUFSIZE); 
-			if (tmp_move != NULL) strncpy(move, tmp_move, MOVEBUFSIZE);
+	pfd.fd = conn->socket_desc;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
 
-			result = SUCCESS;
-		}
+	if (poll(&pfd, 1, timeout_ms) <= 0) {
+		return 0;
 	}
 
-	free(len_buf);
-	free(msg_buf);
+	/* A closed or broken socket is also reported, comms_get_cmd then fails */
+	return 1;
+}
 
-	return result;
+/**
+ * Makes connection, from 0 to MAXCONNECTIONS - 1, the one the other
+ * calls work on
+ */
+int comms_select(int connection) {
+	if (connection < 0 || connection >= MAXCONNECTIONS) return FAILURE;
+	conn = &connections[connection];
+	return SUCCESS;
+}
+
+/* Closes the selected connection, which comms_init_network may then open again */
+void comms_close() {
+	if (conn->open) close(conn->socket_desc);
+	conn->open = 0;
+	conn->connecting = 0;
+	conn->ring_head = conn->ring_tail = 0;
 }
 
 /**
- * Sends a message to the server, which includes my_move 
- * and, if cmd == play_move, also the opponent's move 
+ * Waits up to timeout_ms milliseconds (0 to just look, -1 for as long as
+ * it takes) for the server to send something on any of the first count
+ * connections that are open. Sets ready[i] to 1 for every connection i
+ * a cmd can be read from without blocking, or the colour if it is still
+ * connecting, to 0 for the others, and returns how many are ready
  */
-int comms_send_move(char my_move[]) {
+int comms_ready(int ready[], int count, int timeout_ms) {
+	struct pollfd pfd[MAXCONNECTIONS];
+	connection *selected = conn;
+	int i, n = 0, polled = 0;
 
-	if (send(socket_desc, my_move, strlen(my_move) , 0) < 0) {
-		return FAILURE;
+	for (i = 0; i < count; i++) {
+		conn = &connections[i];
+		ready[i] = conn->open && frame_ready();
+		n += ready[i];
 	}
+	conn = selected;
+	/* A frame already in a ring is as good as one on a socket, there is no need to wait */
+	if (n > 0) timeout_ms = 0;
 
-	return SUCCESS;
+	for (i = 0; i < count; i++) {
+		pfd[i].fd = ready[i] || !connections[i].open ? -1 : connections[i].socket_desc;
+		pfd[i].events = POLLIN;
+		pfd[i].revents = 0;
+		polled += pfd[i].fd != -1;
+	}
+	if (polled == 0 || poll(pfd, count, timeout_ms) <= 0) return n;
+
+	/* A closed or broken socket or a failed connect is also reported, comms_get_cmd or comms_get_colour then fails */
+	for (i = 0; i < count; i++) {
+		if (pfd[i].revents != 0) {
+			ready[i] = 1;
+			n++;
+		}
+	}
+	return n;
 }
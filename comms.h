@@ -6,10 +6,18 @@
 
 #define MOVEBUFSIZE 6
 #define CMDBUFSIZE 100
+/* Most connections to the server that can be open at once */
+#define MAXCONNECTIONS 64
 
 int comms_init(int* my_colour);
 int comms_init_network(int* my_colour, unsigned long ip, int port);
+int comms_connect(unsigned long ip, int port);
+int comms_get_colour(int* my_colour);
 int comms_get_cmd(char cmd[], char move[]);
 int comms_send_move(char move[]);
+int comms_cmd_waiting(int timeout_ms);
+int comms_select(int connection);
+void comms_close();
+int comms_ready(int ready[], int count, int timeout_ms);
 
 #endif
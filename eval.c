@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include "bitboard.h"
+#include "eval.h"
+
+/* Weight of each square of the 10x10 mailbox board, 0 off the board */
+const int weights[100] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+						  0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
+						  0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
+						  0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
+						  0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
+						  0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
+						  0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
+						  0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
+						  0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
+						  0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+/* The corner squares, and the squares next to each corner in the same order */
+static const uint64_t CORNERS = 0x8100000000000081ULL;
+static const uint64_t CORNER_BITS[4] = {0x0000000000000001ULL, 0x0000000000000080ULL, 0x0100000000000000ULL,
+										0x8000000000000000ULL};
+static const uint64_t CORNER_NEIGHBOURS[4] = {0x0000000000000302ULL, 0x000000000000c040ULL, 0x0203000000000000ULL,
+											  0x40c0000000000000ULL};
+
+/**
+ * Sums the weights of the squares of discs, which make_position_move then
+ * keeps up to date move by move.
+ */
+int square_weights(uint64_t discs)
+{
+	int sum = 0;
+
+	for (; discs; discs &= discs - 1)
+		sum += weights[bb_to_square(bb_first(discs))];
+	return sum;
+}
+
+/**
+ * @brief The game_stage function was inspired by a tutorial session where the demi informed me that
+ * I would need to account for the later stages of the game and apply increased weights to the evaluation
+ * function so that the minimax would not just pick the higher weight but rather where it would win.
+ * The stage is from the number of discs on the board.
+ *
+ * @param discs
+ * @return int
+ */
+int disc_stage(int discs)
+{
+	int stage = 0;
+
+	if (discs <= 20)
+	{
+		stage = 1;
+	}
+	else if (discs > 20 && discs <= 40)
+	{
+		stage = 2;
+	}
+	else if (discs > 40)
+	{
+		stage = 3;
+	}
+
+	return stage;
+}
+
+/*
+This evaluation function is inspired by mr peter sieg and a blog for a really good evaluation function that takes into
+account several other heurisitcs such as coin parity, mobility and stability. This combined with the game_state function
+gives me an optimal to play the othello game:
+References are:
+Blog: https://kartikkukreja.wordpress.com/2013/03/30/heuristic-function-for-reversiothello/
+Mr peter sieg github: https://github.com/petersieg/c
+
+Every term is taken from the bitboards directly: the weighted squares from the sums own_weight and opp_weight, and the
+disc counts, mobility and corner terms from popcounts.
+*/
+int evaluate(uint64_t own, uint64_t opp, int own_weight, int opp_weight)
+{
+	uint64_t empty, close;
+	int pcoins, pmoves;
+	int ocoins, omoves;
+	int positional, parity, mobility, final, i;
+	// opponent characteristics:
+	ocoins = bb_count(opp);
+	omoves = bb_count(bb_moves(opp, own));
+	// player characteristics:
+	pcoins = bb_count(own);
+	pmoves = bb_count(bb_moves(own, opp));
+
+	positional = own_weight - opp_weight;
+
+	// Parity:
+	parity = 100 * (pcoins - ocoins) / (pcoins + ocoins);
+	// Mobility:
+	if ((pmoves + omoves) != 0)
+	{
+		mobility = 100 * (pmoves - omoves) / (pmoves + omoves);
+	}
+	else
+	{
+		mobility = 0;
+	}
+	/*Programs runs with just the above*/
+	// Corners Captured
+	int corner_occ = 25 * (bb_count(own & CORNERS) - bb_count(opp & CORNERS));
+
+	// Corner Closeness: the squares next to the corners that are still empty
+	empty = ~(own | opp);
+	close = 0;
+	for (i = 0; i < 4; i++)
+	{
+		if (empty & CORNER_BITS[i])
+			close |= CORNER_NEIGHBOURS[i];
+	}
+
+	int cc = -12.5 * (bb_count(own & close) - bb_count(opp & close));
+
+	mobility = (3 - disc_stage(pcoins + ocoins)) * mobility;
+
+	final = positional + (10 * parity) + (78.922 * mobility) + (801.724 * corner_occ) + (382.026 * cc);
+	return final;
+}
@@ -0,0 +1,19 @@
+#ifndef _EVAL_H
+#define _EVAL_H
+
+#include <stdint.h>
+
+/*
+ * Heuristic evaluator, the one searched with unless a patterns file is
+ * given: weighted squares, disc parity, mobility and corners, from the
+ * bitboards of the side scored and its opponent. The weighted squares come
+ * in as sums the caller keeps up to date, see square_weights.
+ */
+
+extern const int weights[100];
+
+int square_weights(uint64_t discs);
+int disc_stage(int discs);
+int evaluate(uint64_t own, uint64_t opp, int own_weight, int opp_weight);
+
+#endif
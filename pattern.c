@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "comms.h"
+#include "pattern.h"
+#include "pattern_tables.h"
+
+static int16_t *weights;
+
+/**
+ * Allocates the weights of every stage, to be filled by pattern_load or by
+ * the caller through pattern_weights.
+ */
+int pattern_alloc()
+{
+	free(weights);
+	weights = (int16_t *)calloc(pattern_weight_count(), sizeof(int16_t));
+	return weights == NULL ? FAILURE : SUCCESS;
+}
+
+/**
+ * Reads a weights file written for the tables this engine was built with.
+ * Fails on a file that is missing, short, or made for other tables.
+ */
+int pattern_load(const char *path)
+{
+	FILE *in;
+	char magic[4];
+	int32_t header[3];
+	int result = FAILURE;
+
+	in = fopen(path, "rb");
+	if (in == NULL)
+		return FAILURE;
+	if (fread(magic, 1, 4, in) == 4 && memcmp(magic, "SPAT", 4) == 0 && fread(header, sizeof(int32_t), 3, in) == 3 &&
+		header[0] == 1 && header[1] == PATTERN_STAGES && header[2] == PATTERN_STAGE_WEIGHTS &&
+		pattern_alloc() == SUCCESS)
+	{
+		if (fread(weights, sizeof(int16_t), pattern_weight_count(), in) == (size_t)pattern_weight_count())
+			result = SUCCESS;
+	}
+	fclose(in);
+	if (result == FAILURE)
+		pattern_free();
+	return result;
+}
+
+void pattern_free()
+{
+	free(weights);
+	weights = NULL;
+}
+
+int16_t *pattern_weights()
+{
+	return weights;
+}
+
+long pattern_weight_count()
+{
+	return PATTERN_STAGES * PATTERN_STAGE_WEIGHTS;
+}
+
+/**
+ * Sums the weights of every pattern instance for the side owning own, with
+ * the stage taken from the number of discs on the board.
+ */
+int pattern_evaluate(uint64_t own, uint64_t opp)
+{
+	const int16_t *stage;
+	const signed char *squares;
+	int discs = __builtin_popcountll(own | opp);
+	int i, k, bit, n;
+	long index;
+	int score = 0;
+
+	i = (discs - 4) * PATTERN_STAGES / 61;
+	if (i >= PATTERN_STAGES)
+		i = PATTERN_STAGES - 1;
+	stage = weights + i * PATTERN_STAGE_WEIGHTS;
+
+	for (i = 0; i < PATTERN_INSTANCES; i++)
+	{
+		squares = PATTERN_SQUARES[i];
+		n = PATTERN_CLASS_SIZE[PATTERN_INSTANCE_CLASS[i]];
+		index = 0;
+		for (k = 0; k < n; k++)
+		{
+			bit = squares[k];
+			index = 3 * index + ((own >> bit) & 1) + 2 * ((opp >> bit) & 1);
+		}
+		score += stage[PATTERN_CLASS_OFFSET[PATTERN_INSTANCE_CLASS[i]] + index];
+	}
+	return score;
+}
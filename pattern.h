@@ -0,0 +1,23 @@
+#ifndef _PATTERN_H
+#define _PATTERN_H
+
+#include <stdint.h>
+
+/*
+ * Pattern evaluator: the board is cut into edge, corner, row and diagonal
+ * patterns (pattern_tables.h, generated by tools/gen_patterns.c), each read
+ * as a base-3 index into a table of weights for the stage of the game.
+ *
+ * A weights file is the four bytes "SPAT", then int32 version (1), stages
+ * and weights per stage, then the int16 weights of every stage, all in the
+ * byte order of the machine.
+ */
+
+int pattern_alloc();
+int pattern_load(const char *path);
+void pattern_free();
+int16_t *pattern_weights();
+long pattern_weight_count();
+int pattern_evaluate(uint64_t own, uint64_t opp);
+
+#endif
@@ -0,0 +1,67 @@
+/* Generated by tools/gen_patterns.c, do not edit */
+
+#ifndef _PATTERN_TABLES_H
+#define _PATTERN_TABLES_H
+
+#define PATTERN_CLASSES 11
+#define PATTERN_INSTANCES 46
+#define PATTERN_MAX_SQUARES 10
+#define PATTERN_STAGES 6
+
+/* Squares in each class and where its weights start within a stage */
+static const int PATTERN_CLASS_SIZE[PATTERN_CLASSES] = {10, 9, 10, 8, 8, 8, 8, 7, 6, 5, 4};
+static const long PATTERN_CLASS_OFFSET[PATTERN_CLASSES] = {0, 59049, 78732, 137781, 144342, 150903, 157464, 164025, 166212, 166941, 167184};
+#define PATTERN_STAGE_WEIGHTS 167265L
+
+/* The class of each instance and its squares as bit indices, most significant base-3 digit first */
+static const int PATTERN_INSTANCE_CLASS[PATTERN_INSTANCES] = {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10};
+static const signed char PATTERN_SQUARES[PATTERN_INSTANCES][PATTERN_MAX_SQUARES] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 9, 14}, /* edge + 2X */
+	{56, 57, 58, 59, 60, 61, 62, 63, 49, 54}, /* edge + 2X */
+	{0, 8, 16, 24, 32, 40, 48, 56, 9, 49}, /* edge + 2X */
+	{7, 15, 23, 31, 39, 47, 55, 63, 14, 54}, /* edge + 2X */
+	{0, 1, 2, 8, 9, 10, 16, 17, 18, -1}, /* corner 3x3 */
+	{7, 6, 5, 15, 14, 13, 23, 22, 21, -1}, /* corner 3x3 */
+	{56, 57, 58, 48, 49, 50, 40, 41, 42, -1}, /* corner 3x3 */
+	{63, 62, 61, 55, 54, 53, 47, 46, 45, -1}, /* corner 3x3 */
+	{0, 1, 2, 3, 4, 8, 9, 10, 11, 12}, /* corner 2x5 */
+	{7, 6, 5, 4, 3, 15, 14, 13, 12, 11}, /* corner 2x5 */
+	{56, 57, 58, 59, 60, 48, 49, 50, 51, 52}, /* corner 2x5 */
+	{63, 62, 61, 60, 59, 55, 54, 53, 52, 51}, /* corner 2x5 */
+	{0, 8, 16, 24, 32, 1, 9, 17, 25, 33}, /* corner 2x5 */
+	{56, 48, 40, 32, 24, 57, 49, 41, 33, 25}, /* corner 2x5 */
+	{7, 15, 23, 31, 39, 6, 14, 22, 30, 38}, /* corner 2x5 */
+	{63, 55, 47, 39, 31, 62, 54, 46, 38, 30}, /* corner 2x5 */
+	{8, 9, 10, 11, 12, 13, 14, 15, -1, -1}, /* row 2 */
+	{48, 49, 50, 51, 52, 53, 54, 55, -1, -1}, /* row 2 */
+	{1, 9, 17, 25, 33, 41, 49, 57, -1, -1}, /* row 2 */
+	{6, 14, 22, 30, 38, 46, 54, 62, -1, -1}, /* row 2 */
+	{16, 17, 18, 19, 20, 21, 22, 23, -1, -1}, /* row 3 */
+	{40, 41, 42, 43, 44, 45, 46, 47, -1, -1}, /* row 3 */
+	{2, 10, 18, 26, 34, 42, 50, 58, -1, -1}, /* row 3 */
+	{5, 13, 21, 29, 37, 45, 53, 61, -1, -1}, /* row 3 */
+	{24, 25, 26, 27, 28, 29, 30, 31, -1, -1}, /* row 4 */
+	{32, 33, 34, 35, 36, 37, 38, 39, -1, -1}, /* row 4 */
+	{3, 11, 19, 27, 35, 43, 51, 59, -1, -1}, /* row 4 */
+	{4, 12, 20, 28, 36, 44, 52, 60, -1, -1}, /* row 4 */
+	{0, 9, 18, 27, 36, 45, 54, 63, -1, -1}, /* diagonal 8 */
+	{7, 14, 21, 28, 35, 42, 49, 56, -1, -1}, /* diagonal 8 */
+	{1, 10, 19, 28, 37, 46, 55, -1, -1, -1}, /* diagonal 7 */
+	{6, 13, 20, 27, 34, 41, 48, -1, -1, -1}, /* diagonal 7 */
+	{57, 50, 43, 36, 29, 22, 15, -1, -1, -1}, /* diagonal 7 */
+	{62, 53, 44, 35, 26, 17, 8, -1, -1, -1}, /* diagonal 7 */
+	{2, 11, 20, 29, 38, 47, -1, -1, -1, -1}, /* diagonal 6 */
+	{5, 12, 19, 26, 33, 40, -1, -1, -1, -1}, /* diagonal 6 */
+	{58, 51, 44, 37, 30, 23, -1, -1, -1, -1}, /* diagonal 6 */
+	{61, 52, 43, 34, 25, 16, -1, -1, -1, -1}, /* diagonal 6 */
+	{3, 12, 21, 30, 39, -1, -1, -1, -1, -1}, /* diagonal 5 */
+	{4, 11, 18, 25, 32, -1, -1, -1, -1, -1}, /* diagonal 5 */
+	{59, 52, 45, 38, 31, -1, -1, -1, -1, -1}, /* diagonal 5 */
+	{60, 51, 42, 33, 24, -1, -1, -1, -1, -1}, /* diagonal 5 */
+	{3, 10, 17, 24, -1, -1, -1, -1, -1, -1}, /* diagonal 4 */
+	{4, 13, 22, 31, -1, -1, -1, -1, -1, -1}, /* diagonal 4 */
+	{59, 50, 41, 32, -1, -1, -1, -1, -1, -1}, /* diagonal 4 */
+	{60, 53, 46, 39, -1, -1, -1, -1, -1, -1} /* diagonal 4 */
+};
+
+#endif
@@ -40,7 +40,17 @@
 #include <mpi.h>
 #include <time.h>
 #include <assert.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
 #include "comms.h"
+#include "bitboard.h"
+#include "tt.h"
+#include "eval.h"
+#include "pattern.h"
+#include "book.h"
+#include "trace.h"
 
 const int EMPTY = 0;
 const int BLACK = 1;
@@ -52,37 +62,372 @@ const int BOARDSIZE = 100;
 const int TRUE = 1;
 const int FALSE = 0;
 const int SHARE = 1;
+const int INFINITY_SCORE = 10000000;
+/* Reported instead of a score by a search that ran into the deadline */
+const int ABORTED_SCORE = -10000001;
+/* Exact endgame results score beyond anything evaluate can return */
+const int WIN_SCORE = 1000000;
+/* Above this many empties the exact solver orders its moves fastest-first */
+const int FASTEST_FIRST_EMPTIES = 7;
+/* Heuristic iterations searched before an exact solve, to have a move to fall back on */
+const int ENDGAME_PREPARE_DEPTH = 4;
+/* Least growth in time per ply assumed when predicting how long an exact solve takes */
+const double ENDGAME_MIN_GROWTH = 3.0;
+/* History counts are halved before any reaches this, so they stay below the killer move keys */
+const int HISTORY_LIMIT = 1 << 20;
+/* How many nodes are searched between looks at the clock */
+const int CLOCK_CHECK_NODES = 1024;
+/* Split nodes are only made where at least this much depth is left below them */
+const int MIN_SPLIT_DEPTH = 4;
+// The status of a job_result
+const int JOB_DONE = 0;
+const int JOB_ABORTED = 1;
+const int JOB_CLOSED = 2;
+// Milliseconds rank 0 waits at a time with nothing of its own to search, while it watches the clock or the referee
+const int WAIT_POLL_MS = 2;
+// The worker_node of a rank searching a speculative job, which is below no split node
+const int SPECULATION = -2;
+/* ProbCut trusts a shallow search once it is this many typical errors of its fit beyond the window */
+const double PROBCUT_SIGMAS = 1.5;
+/* Shallowest node depth ProbCut is fitted and tried at */
+const int PROBCUT_MIN_DEPTH = 3;
 
 const int LEGALMOVSBUFSIZE = 65;
 const char piecenames[4] = {'.', 'b', 'w', '?'};
 
+/* Deeper than any search can go: a game has at most 60 moves plus passes */
+#define MAXPLY 64
+/* Deepest split ply, and how many split nodes rank 0 can keep open at once */
+#define MAXSPLITPLY 8
+#define MAXSPLITNODES 1024
+/* Most search threads a rank can run */
+#define MAXTHREADS 64
+/* Stands for a pass in the move path of a job */
+#define PASS 0
+/*
+Flags of a board_message: the workers search the board, or the game is over and they stop. With BOARD_DELTA the
+message holds the moves made since the last board instead of the board, with BOARD_CHECK also the key of the board.
+*/
+#define BOARD_RUNNING 1
+#define BOARD_DELTA 2
+#define BOARD_CHECK 4
+/* Most moves a board_message can hold */
+#define MAXSYNCMOVES 16
+
+/*
+A board as one bitboard per colour, indexed by BLACK and WHITE, its Zobrist key and the sum of the weights of the
+squares each colour holds. The key and the sums are kept up to date by make_position_move.
+*/
+typedef struct position
+{
+	uint64_t discs[3];
+	uint64_t key;
+	int weight[3];
+} position;
+
+/* Settings from the optional name=value arguments, broadcast from rank 0 to every rank */
+typedef struct options
+{
+	int margin;	  /* milliseconds of the time limit kept back as a safety margin */
+	int hash;	  /* megabytes of transposition table per rank */
+	int ordering; /* move ordering in alpha_beta and at the root on or off */
+	int endgame;  /* empties from which the game is solved exactly, 0 for never */
+	int split;	  /* plies of the tree kept at rank 0 as split nodes */
+	int threads;  /* search threads per searching rank, sharing its transposition table */
+	int ponder;	  /* search the opponent's replies while waiting for its move */
+	int sync;	  /* 0 broadcasts the board, n the moves since the last one and every n-th time its key */
+	int pvs;	  /* null windows for all but the first move of a node on or off */
+	int aspiration; /* half width of the window around the score of the last iteration, 0 for a full window */
+	int speculate;	/* idle workers search the opponent's replies to the best move at the end of an iteration */
+	int shared;		/* depth from which nodes go to the table distributed over all ranks as well, 0 for never */
+	int canonical;	/* positions with at most this many discs share a table entry with their mirror images */
+	int games;		/* games rank 0 plays at once over connections of their own, 0 for a single game */
+	int fit;		/* deepest depth a benchmark logs score pairs at for fitting ProbCut, 0 for none */
+	char patterns[256]; /* weights file of the pattern evaluator, empty for evaluate */
+	char probcut[256];	/* fitted ProbCut parameters, see tools/fit_probcut.c, empty for none */
+	char book[256];		/* opening book file, only used at rank 0, empty for none */
+	char trace[256];	/* rank r writes its event trace to this file name with .r appended, empty for none */
+} options;
+
+/* Counts kept by every search thread, summed over the threads and ranks at the end of each gen_move */
+typedef struct search_stats
+{
+	long nodes;			/* calls of alpha_beta and solve */
+	long evals;			/* positions scored by evaluate */
+	long cutoffs;		/* beta cutoffs in alpha_beta */
+	long first_cutoffs; /* cutoffs caused by the first move searched */
+	long tt_probes;
+	long tt_hits;
+	long shared_probes; /* probes of the distributed table, which only main threads make */
+	long shared_hits;
+	long probcuts; /* nodes ProbCut settled without searching them to their full depth */
+} search_stats;
+
+/*
+How a search of a node at one depth follows from a search of it at the shallower depth shallow, for one game_stage:
+about a * the shallow score + b, off by sigma on average, the scores from the side to move at the node. A shallow of 0
+means there is no fit.
+*/
+typedef struct probcut_fit
+{
+	int shallow;
+	float a;
+	float b;
+	float sigma;
+} probcut_fit;
+
+/*
+What a search runs within, shared by the thread searching it and the helper threads searching alongside: the window
+of its job, which rank 0 may tighten while it runs, whether rank 0 has stopped the job, the monotonic time at which
+it must stop, 0 if there is no deadline, and whether the helpers are to stop as the searching thread has its result.
+*/
+typedef struct search_limits
+{
+	volatile int alpha;
+	volatile int beta;
+	volatile int stopped;
+	volatile int helpers_stop;
+	double deadline;
+} search_limits;
+
+/* What the helper threads of a rank search alongside its main thread */
+typedef struct smp_task
+{
+	position root;
+	int move;
+	int alpha;
+	int beta;
+	int colour;
+	int depth;
+	int side;	/* the side the scores are from */
+	int ply;	/* ply of the root from the board of the gen_move */
+	int search; /* which gen_move this is part of */
+	int quit;
+	search_limits *limits;
+} smp_task;
+
+/*
+The helper threads of a searching thread. It hands them its search in task and counts tasks up, they search it as
+well and count running down as they finish, adding their counts and the deepest ply they reached into stats and
+max_ply. Each takes the next number of joined as its own.
+*/
+typedef struct helper_pool
+{
+	pthread_t threads[MAXTHREADS];
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	smp_task task;
+	int tasks;
+	int running;
+	int started;
+	int joined;
+	search_stats stats;
+	int max_ply;
+} helper_pool;
+
+/*
+Everything a search changes as it runs, so that searches on different threads share nothing but the transposition
+table and, with their helpers, their limits: the positions along its path, stack[0] being the root, the side its
+scores are from, the ply of its root from the board of the gen_move and the deepest ply it reached, its counts, its
+move ordering state and the empty list of the exact solver, and whether it has been given up. The main thread of a
+rank searches with main_search, every helper thread with its own.
+*/
+typedef struct search_context
+{
+	position stack[MAXPLY];
+	int side;
+	int root_ply;
+	int max_ply;
+	int aborted;
+	int helper;	 /* TRUE on a helper thread, which makes no MPI calls */
+	int probing; /* how many ProbCut tests deep the search is, which keep their windows apart from the job's */
+	search_limits *limits;
+	helper_pool *pool; /* the helper threads searching alongside, NULL on a helper thread */
+	search_stats stats;
+	int history[3][100];	 /* cutoff counts per colour and square */
+	int killers[MAXPLY][2]; /* two killer moves per ply */
+	int empty_next[BB_SQUARES + 1];
+	int empty_prev[BB_SQUARES + 1];
+	int empty_parity;
+	FILE *log;
+} search_context;
+
+/*
+A subtree handed to a worker, sent on tag 100: the moves leading to it from the board of the gen_move, PASS for a
+pass, the last one being the move to search. An id of -1 ends the gen_move.
+*/
+typedef struct search_job
+{
+	int id;
+	int depth;
+	int alpha;
+	int beta;
+	int length;
+	int path[2 * MAXSPLITPLY + 1];
+} search_job;
+
+/*
+The answer to a job, sent on tag 105. status is JOB_DONE, JOB_ABORTED if the deadline or a stop on tag 115 cut it
+short, or JOB_CLOSED if rank 0 closed the window of the job before it finished, in which case score means nothing.
+*/
+typedef struct job_result
+{
+	int id;
+	int move; /* the move searched, the last of the path of the job */
+	int score;
+	int status;
+} job_result;
+
+/*
+The board of a search, broadcast from rank 0 to every rank as board_type at the start of a gen_move: the discs of
+each colour, the side to move, the side the search plays for, the BOARD flags and the milliseconds the search may
+take, negative for no deadline.
+With BOARD_DELTA, byte i of discs from the low end is the i-th move since the last board: 0x80 | 0x40 if White
+played it | its bit, 0 after the last move.
+*/
+typedef struct board_message
+{
+	uint64_t discs[2]; /* BLACK, WHITE */
+	uint64_t check;	   /* Zobrist key of the board with BOARD_CHECK */
+	int32_t mover;
+	int32_t colour;
+	int32_t flags;
+	int32_t budget;
+} board_message;
+
+/* A tighter window for a job that is being searched, sent on tag 110 */
+typedef struct bound_update
+{
+	int id;
+	int alpha;
+	int beta;
+} bound_update;
+
+/* A node of the top of the tree searched at rank 0 by handing its children out. Arrays of moves are 1-based. */
+typedef struct split_node
+{
+	position pos;
+	int in_use;
+	int parent;	  /* split node this is a child of, -1 for the root */
+	int child;	  /* which child of the parent this is */
+	int mover;	  /* side to move */
+	int depth;	  /* depth each child is searched to */
+	int ply;
+	int alpha;
+	int beta;
+	int moves[BB_SQUARES + 1];
+	int scores[BB_SQUARES + 1];
+	int started;
+	int finished;
+	int cut;
+	int best_move;
+	int length;
+	int path[2 * MAXSPLITPLY + 1];
+} split_node;
+
+/*
+A game played with opts.games, on the referee connection of the same number. While rank 0 serves one of its commands
+the game's board, colour and move count are in board, my_colour and move_number, and its log is fp.
+*/
+typedef struct game_session
+{
+	int board[100];
+	int colour;
+	int move_number;
+	int open;		/* FALSE once the referee takes no more games on the connection */
+	int playing;	/* FALSE while the connection waits for the colour of its next game */
+	int played;		/* games finished on the connection */
+	double arrival; /* monotonic time by which its next command had arrived, 0 if none is known to have */
+	FILE *log;
+} game_session;
+
 void run_master(int argc, char *argv[]);
 int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp);
+int play_command(FILE *fp);
+int start_session(int game);
+void begin_session(int game);
+void end_session(int game);
+void switch_session(int game);
+int next_session();
+void search_move(char *move, FILE *fp);
 void gen_move_master(char *move, int my_colour, FILE *fp);
+void ponder_master(FILE *fp);
+int book_move(char *move, int my_colour, FILE *fp);
 void apply_opp_move(char *move, int my_colour, FILE *fp);
+void run_benchmark(FILE *fp);
+int load_bench_position(char *line);
 void game_over();
 void run_worker();
 void initialise_board();
+void reset_board(int *board);
 void free_board();
-int serial(char *move, int my_colour, FILE *fp);
+int serial(int *moves, int *scores, int depth, int alpha, int beta);
+int split_search(int *moves, int *scores, int depth, int alpha, int beta, FILE *fp);
+void node_window(int n, int *alpha, int *beta);
+void schedule(FILE *fp);
+void start_child(int n, FILE *fp);
+void child_result(int n, int c, int value);
+void send_bounds();
+void abort_iteration();
+void finish_job(int r, job_result *result, FILE *fp);
+int child_ready(int n);
+void speculate(FILE *fp);
+void stop_speculation(int count);
+void serve_workers();
+void run_job(search_job *job, job_result *result, search_context *ctx);
+void poll_messages(search_limits *limits);
+int search_interrupted(search_context *ctx);
+void start_helpers(helper_pool *pool);
+void stop_helpers(helper_pool *pool);
+void *helper_thread(void *arg);
+int smp_search(int move, int alpha, int beta, int colour, int depth, search_context *ctx);
+void reset_stats();
+void gather_stats(search_stats *total, int *deepest, double *idle);
+void report_stats(int depth, char *move, double elapsed, FILE *fp);
+int order_moves(position *pos, uint64_t moves, int player, int tt_move, int ply, int *list, search_context *ctx);
+int drop_symmetric_moves(position *pos, int player, int *moves, FILE *fp);
+int map_square(int square, int symmetry, int inverse);
+void sort_moves(int *moves, int *scores);
+void order_by_cost(int *moves);
+void age_history(search_context *ctx);
+int endgame_score(int discs);
+int final_discs(uint64_t own, uint64_t opp);
+void store_result(uint64_t key, int depth, int result, int alpha, int beta, int move, search_context *ctx);
+int solve(uint64_t own, uint64_t opp, int alpha, int beta, int empties, int passed, search_context *ctx);
+int endgame_search(position *pos, int player, int alpha, int beta, search_context *ctx);
+int parse_option(char *option);
+void initialise_search();
+void create_board_type();
+int broadcast_board(int flags, int mover, int *budget);
+uint64_t board_key(FILE *fp);
+double monotonic_time();
+void set_deadline(search_context *ctx, int budget);
+int time_up(search_limits *limits);
 void legal_moves(int player, int *moves, FILE *fp);
 int legalp(int move, int player, FILE *fp);
 int validp(int move);
-int would_flip(int move, int dir, int player, FILE *fp);
 int opponent(int player, FILE *fp);
-int find_bracket_piece(int square, int dir, int player, FILE *fp);
+void get_bitboards(int *board, int player, uint64_t *own, uint64_t *opp, FILE *fp);
+void load_position(int *board, position *pos, FILE *fp);
+void make_position_move(position *pos, int move, int player, FILE *fp);
 int random_strategy(int my_colour, FILE *fp);
 void make_move(int move, int player, FILE *fp);
-void make_flips(int move, int dir, int player, FILE *fp);
 int get_loc(char *movestring);
 void get_move_string(int loc, char *ms);
 void print_board(FILE *fp);
 char nameof(int piece);
 int count(int player, int *board);
-int minimax(int move, int colour, int *sent_board, FILE *fp);
-int alpha_beta(int move_made, int alpha, int beta, int colour, int depth, int *sent_board, FILE *fp);
-int evaluate(int player, int *board, FILE *fp);
-int game_stage();
+int dynamic_depth(int moves);
+int minimax(int move, int colour, int depth, int alpha, int beta, int *sent_board, search_context *ctx);
+int alpha_beta(int move_made, int alpha, int beta, int colour, int depth, int ply, search_context *ctx);
+int heuristic_score(int player, position *pos);
+int pattern_score(int player, position *pos);
+int game_stage(position *pos);
+int load_probcut(char *path);
+int probcut_cut(int move_made, int alpha, int beta, int colour, int depth, int ply, int mover, int *result,
+				search_context *ctx);
+void fit_probcut(FILE *fp);
 
 
 int size;
@@ -95,27 +440,111 @@ int *moves;
 int *scores;
 FILE *fp;
 
-int weights[100] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
-					0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
-					0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
-					0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
-					0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
-					0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
-					0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
-					0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+options opts = {250, 16, TRUE, 18, 2, 1, FALSE, 0, TRUE, 0, FALSE, 0, 0, 0, 0, "", "", "", ""};
+/* TRUE once the weights of opts.patterns are loaded on this rank */
+int use_patterns;
+/* The fits of opts.probcut by game_stage and depth, and TRUE once they are loaded and searches may use them */
+probcut_fit probcut[4][MAXPLY];
+int use_probcut;
+/* Counts searches, so that helper threads know when to age their move ordering state */
+int search_number;
+/* Counts the moves rank 0 has made, and is TRUE while it ponders on the opponent's time */
+int move_number;
+int pondering;
+/*
+TRUE when rank 0 runs a benchmark instead of a game: the file of positions it searches or "selfplay", the number of
+the current search and the move the file expects from it, empty if it expects none.
+*/
+int benchmark;
+char *bench_positions;
+int bench_position;
+char bench_expected[MOVEBUFSIZE];
+/* The side to move on the board of the current search, which every job starts from */
+int root_mover;
+/* The MPI datatype of a board_message */
+MPI_Datatype board_type;
+/* The moves rank 0 has made on the board since it last broadcast it, how many and how many boards it has sent */
+int sync_moves[MAXSYNCMOVES];
+int sync_count;
+int boards_sent;
+/*
+The search of the main thread of this rank, its limits and its helper threads, which search alongside it one ply
+deeper every other thread. Only the main thread makes MPI calls.
+*/
+search_limits main_limits;
+helper_pool main_pool = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+						 .wake = PTHREAD_COND_INITIALIZER,
+						 .done = PTHREAD_COND_INITIALIZER};
+search_context main_search = {.limits = &main_limits, .pool = &main_pool};
+/* How long the main thread of this rank has waited on other ranks during the gen_move */
+double idle_time;
+
+/* The job this worker is searching, whose window and stop are in the limits of main_search */
+int current_job;
+
+/* The split nodes of rank 0 and, per worker rank, the split node and child it is searching and the window it has */
+split_node split_nodes[MAXSPLITNODES];
+int *worker_node;
+int *worker_child;
+int *worker_job;
+int *worker_alpha;
+int *worker_beta;
+double *worker_start;
+int idle_ranks;
+int job_count;
+int root_done;
+int aborting;
+/* The best root move of an abandoned iteration among the ones it finished, -1 if it did not finish the eldest */
+int partial_move;
+/*
+Seconds the jobs below each root move took, by square: in the last finished iteration of this gen_move and so far
+in the current one. makespan is how long the last finished iteration took.
+*/
+double move_cost[100];
+double iteration_cost[100];
+double makespan;
+/*
+With opts.speculate, workers left idle at the end of an iteration search the opponent's likeliest replies to
+speculation_move, the best move of the last finished iteration, -1 for none. worker_reply is the reply each worker
+was last given, -1 for none, and worker_blocked is TRUE for a worker that may not be given another in this
+iteration: its stop has been sent, or its last one ran to the end. warm_rank is the worker that searched the reply
+the opponent went on to play, which is handed work first in the next gen_move, -1 for none. speculative_jobs counts
+the speculative jobs of the gen_move.
+*/
+int speculation_move = -1;
+int *worker_reply;
+int *worker_blocked;
+int warm_rank = -1;
+int speculative_jobs;
+/* The job rank 0 has handed itself, and TRUE while it searches it and answers the workers in between */
+search_job local_job;
+int serving;
+/*
+With opts.games, the games rank 0 plays on the referee at referee_ip and referee_port, the one whose command it is
+serving, -1 for none, and the log every finished game gets a line in. last_look is when rank 0 last looked for
+commands on the connections, and command_wait how many seconds the command being served waited for rank 0 to
+finish with the other games, which its search has less time for.
+*/
+game_session sessions[MAXCONNECTIONS];
+int session = -1;
+unsigned long referee_ip;
+int referee_port;
+FILE *tournament_log;
+double last_look;
+double command_wait;
+
 
-typedef struct score_result
-{
-	int result;
-	int move;
-} score_result;
+
+/* Persistent receives at rank 0 for the result of each worker, started whenever the worker is sent a job */
+job_result *worker_result;
+MPI_Request *worker_request;
 
 int main(int argc, char *argv[])
 {
+	int provided;
 
-	MPI_Init(&argc, &argv);
+	// Helper threads search but never call MPI, so funneled is all that is needed
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &size);
 
@@ -129,6 +558,12 @@ int main(int argc, char *argv[])
 	{
 		initialise_board();
 		run_worker(rank);
+		stop_helpers(&main_pool);
+		tt_free();
+		tt_unshare();
+		pattern_free();
+		trace_close();
+		MPI_Type_free(&board_type);
 		MPI_Finalize();
 	}
 	return 0;
@@ -136,9 +571,7 @@ int main(int argc, char *argv[])
 
 void run_master(int argc, char *argv[])
 {
-	char cmd[CMDBUFSIZE];
-	char my_move[MOVEBUFSIZE];
-	char opponent_move[MOVEBUFSIZE];
+	int budget, game = 0;
 
 	running = 0;
 	fp = NULL;
@@ -151,77 +584,325 @@ void run_master(int argc, char *argv[])
 		my_colour = BLACK;
 	// Broadcast my_colour
 	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	// Broadcast the options
+	MPI_Bcast(&opts, sizeof(options), MPI_BYTE, 0, MPI_COMM_WORLD);
+	initialise_search();
+	budget = -1;
+
+	if (running == 1 && benchmark)
+	{
+		run_benchmark(fp);
+		running = 0;
+	}
 
 	while (running == 1)
 	{
-		/* Receive next command from referee */
-		if (comms_get_cmd(cmd, opponent_move) == FAILURE)
+		// With opts.games the command served next is the one that has waited longest, whichever game it is of
+		if (opts.games > 0)
 		{
-			fprintf(fp, "Error getting cmd\n");
-			fflush(fp);
-			running = 0;
-			break;
+			game = next_session();
+			if (game == -1)
+			{
+				running = 0;
+				continue;
+			}
+			switch_session(game);
+		}
+		if (play_command(fp) == FALSE)
+		{
+			if (opts.games > 0)
+				end_session(game);
+			else
+				running = 0;
+		}
+	}
+	// The workers stop on a board without BOARD_RUNNING
+	broadcast_board(0, my_colour, &budget);
+}
+
+/**
+ * @brief Reads the next command from the referee and carries it out: a move is searched and sent for gen_move, the
+ * opponent's move made for play_move. Returns FALSE once the game is over or the connection has failed.
+ *
+ * @param fp
+ * @return int
+ */
+int play_command(FILE *fp)
+{
+	char cmd[CMDBUFSIZE];
+	char my_move[MOVEBUFSIZE];
+	char opponent_move[MOVEBUFSIZE];
+
+	/* Receive next command from referee */
+	if (comms_get_cmd(cmd, opponent_move) == FAILURE)
+	{
+		fprintf(fp, "Error getting cmd\n");
+		fflush(fp);
+		return FALSE;
+	}
+
+	/* Received game_over message */
+	if (strcmp(cmd, "game_over") == 0)
+	{
+		fprintf(fp, "Game over\n");
+		fflush(fp);
+		return FALSE;
+
+		/* Received gen_move message */
+	}
+	else if (strcmp(cmd, "gen_move") == 0)
+	{
+		// A book move is played without a search; the workers get it with the next board broadcast_board sends
+		if (!book_move(my_move, my_colour, fp))
+		{
+			search_move(my_move, fp);
 		}
 
-		/* Received game_over message */
-		if (strcmp(cmd, "game_over") == 0)
+		if (comms_send_move(my_move) == FAILURE)
 		{
-			running = 0;
-			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
-			fprintf(fp, "Game over\n");
+			fprintf(fp, "Move send failed\n");
 			fflush(fp);
-			break;
-
-			/* Received gen_move message */
+			return FALSE;
 		}
-		else if (strcmp(cmd, "gen_move") == 0)
+		print_board(fp);
+		trace_flush();
+		if (opts.ponder)
 		{
-			// Broadcast running
-			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
-			// Broadcast board
-			MPI_Bcast(board, BOARDSIZE, MPI_INT, 0, MPI_COMM_WORLD);
+			ponder_master(fp);
+		}
 
-			gen_move_master(my_move, my_colour, fp);
+		/* Received opponent's move (play_move mesage) */
+	}
+	else if (strcmp(cmd, "play_move") == 0)
+	{
+		apply_opp_move(opponent_move, my_colour, fp);
+		print_board(fp);
 
-			if (comms_send_move(my_move) == FAILURE)
-			{
-				running = 0;
-				fprintf(fp, "Move send failed\n");
-				fflush(fp);
-				break;
-			}
-			print_board(fp);
+		/* Received unknown message */
+	}
+	else
+	{
+		fprintf(fp, "Received unknown command from referee\n");
+	}
+	return TRUE;
+}
 
-			/* Received opponent's move (play_move mesage) */
-		}
-		else if (strcmp(cmd, "play_move") == 0)
-		{
-			apply_opp_move(opponent_move, my_colour, fp);
-			print_board(fp);
+/**
+ * @brief Starts connecting game to the referee for a new game, without waiting for the connection or the colour, so
+ * that the other games are served in the meantime. The game is playing once begin_session has its colour. Returns
+ * FAILURE, writing it to the tournament log, and leaves the game closed if the connect fails straight away.
+ *
+ * @param game
+ * @return int
+ */
+int start_session(int game)
+{
+	game_session *s = &sessions[game];
+
+	fprintf(s->log, "Initialise communication and get player colour \n");
+	fflush(s->log);
+	comms_select(game);
+	s->open = comms_connect(referee_ip, referee_port) != FAILURE;
+	s->playing = FALSE;
+	if (!s->open)
+	{
+		fprintf(tournament_log, "{\"connection\": %d, \"game\": %d, \"error\": \"could not connect\"}\n", game,
+				s->played + 1);
+		fflush(tournament_log);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/**
+ * @brief Reads the colour of the new game on game, once next_session has found it come, and sets the game up from
+ * the starting position. If the connect has failed or the referee has closed the connection instead, which it does
+ * when it takes no more games, the game is closed and that is written to the tournament log.
+ *
+ * @param game
+ */
+void begin_session(int game)
+{
+	game_session *s = &sessions[game];
 
-			/* Received unknown message */
+	comms_select(game);
+	if (comms_get_colour(&s->colour) == FAILURE)
+	{
+		fprintf(s->log, "No colour from the referee, the connection is closed\n");
+		fflush(s->log);
+		fprintf(tournament_log, "{\"connection\": %d, \"game\": %d, \"error\": \"no colour\"}\n", game,
+				s->played + 1);
+		fflush(tournament_log);
+		comms_close();
+		s->open = FALSE;
+		return;
+	}
+	if (s->colour == EMPTY)
+		s->colour = BLACK;
+	reset_board(s->board);
+	s->move_number = 0;
+	s->arrival = 0;
+	s->playing = TRUE;
+	// The connection selected is the one of the game being served
+	if (session != -1)
+		comms_select(session);
+}
+
+/**
+ * @brief Closes the connection of game, whose game has just ended, writing its final disc counts to the tournament
+ * log, and starts connecting again for the next game. game must be the one being served.
+ *
+ * @param game
+ */
+void end_session(int game)
+{
+	game_session *s = &sessions[game];
+
+	fprintf(tournament_log, "{\"connection\": %d, \"game\": %d, \"colour\": \"%c\", \"own\": %d, \"opponent\": %d}\n",
+			game, ++s->played, nameof(my_colour), count(my_colour, board), count(opponent(my_colour, fp), board));
+	fflush(tournament_log);
+	comms_close();
+	// Nothing of the game is kept for the next one on the connection
+	session = -1;
+	start_session(game);
+}
+
+/**
+ * @brief Makes game the one rank 0 serves, keeping board, my_colour and move_number in the session of the game it
+ * served last. The workers still have the board of the other game and may have searched ahead in it, so the next
+ * board is broadcast whole and nothing is taken from their speculation.
+ *
+ * @param game
+ */
+void switch_session(int game)
+{
+	if (game == session)
+		return;
+	if (session != -1)
+	{
+		memcpy(sessions[session].board, board, BOARDSIZE * sizeof(int));
+		sessions[session].colour = my_colour;
+		sessions[session].move_number = move_number;
+	}
+	session = game;
+	memcpy(board, sessions[game].board, BOARDSIZE * sizeof(int));
+	my_colour = sessions[game].colour;
+	move_number = sessions[game].move_number;
+	fp = sessions[game].log;
+	main_search.log = fp;
+	comms_select(game);
+	sync_count = MAXSYNCMOVES + 1;
+	speculation_move = -1;
+	warm_rank = -1;
+}
+
+/**
+ * @brief Waits for a command from the referee on any open game and returns the game whose command has waited
+ * longest, leaving in command_wait how long that was, or -1 once every connection is closed. The colour of a new
+ * game is taken in by begin_session as it comes, without holding up the commands of the others. Rank 0 cannot tell
+ * when during the last command it served another one came, so a command found now is taken to have been there since
+ * it last looked, or since the last one arrived if it is on the same connection: the wait may be overestimated but
+ * never under.
+ *
+ * @return int
+ */
+int next_session()
+{
+	int ready[MAXCONNECTIONS];
+	int game, open, best = -1;
+	double now;
+
+	// A command that came along with the one just served, or while it was, has waited since that one arrived
+	if (session != -1 && comms_cmd_waiting(0))
+		sessions[session].arrival = last_look - command_wait;
+	while (best == -1)
+	{
+		for (game = 0, open = FALSE; game < opts.games; game++)
+			open |= sessions[game].open;
+		if (!open)
+			return -1;
+		if (comms_ready(ready, opts.games, 0) == 0)
+		{
+			// Whatever comes while rank 0 waits is served as soon as it comes
+			while (comms_ready(ready, opts.games, -1) == 0)
+				;
+			last_look = monotonic_time();
 		}
-		else
+		for (game = 0; game < opts.games; game++)
 		{
-			fprintf(fp, "Received unknown command from referee\n");
+			if (ready[game] && !sessions[game].playing)
+			{
+				begin_session(game);
+				continue;
+			}
+			if (ready[game] && sessions[game].arrival == 0)
+				sessions[game].arrival = last_look;
+			if (ready[game] && (best == -1 || sessions[game].arrival < sessions[best].arrival))
+				best = game;
 		}
 	}
-	// Broadcast running
-	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	now = monotonic_time();
+	command_wait = now - sessions[best].arrival;
+	sessions[best].arrival = 0;
+	last_look = now;
+	return best;
 }
 
 int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp)
 {
 	int result = FAILURE;
+	int i;
+	char path[CMDBUFSIZE + 16];
 
-	if (argc == 5)
+	if (argc >= 5)
 	{
 		unsigned long ip = inet_addr(argv[1]);
 		int port = atoi(argv[2]);
 		*time_limit = atoi(argv[3]);
+		benchmark = strcmp(argv[1], "bench") == 0;
+
+		for (i = 5; i < argc; i++)
+		{
+			if (parse_option(argv[i]) == FAILURE)
+			{
+				fprintf(stderr, "Unknown option %s\n", argv[i]);
+				return FAILURE;
+			}
+		}
+
+		if (opts.book[0] != '\0' && book_open(opts.book) == FAILURE)
+		{
+			fprintf(stderr, "Could not open the opening book %s, playing without it\n", opts.book);
+			opts.book[0] = '\0';
+		}
 
 		*fp = fopen(argv[4], "w");
-		if (*fp != NULL)
+		if (*fp != NULL && benchmark)
+		{
+			// The positions stand in for the referee, there is no one to connect to
+			bench_positions = argv[2];
+			result = SUCCESS;
+		}
+		else if (*fp != NULL && opts.games > 0)
+		{
+			// Every game has a log of its own, named after the one of the tournament
+			tournament_log = *fp;
+			referee_ip = ip;
+			referee_port = port;
+			for (i = 0; i < opts.games; i++)
+			{
+				snprintf(path, sizeof(path), "%.*s.%d", CMDBUFSIZE, argv[4], i);
+				sessions[i].log = fopen(path, "w");
+				if (sessions[i].log == NULL)
+					fprintf(stderr, "File %s could not be opened, game %d is not played\n", path, i);
+				else if (start_session(i) != FAILURE)
+					result = SUCCESS;
+			}
+			last_look = monotonic_time();
+			// Rank 0 can only ponder one game, and the others would wait on it
+			opts.ponder = FALSE;
+		}
+		else if (*fp != NULL)
 		{
 			fprintf(*fp, "Initialise communication and get player colour \n");
 			if (comms_init_network(my_colour, ip, port) != FAILURE)
@@ -237,257 +918,806 @@ int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, F
 	}
 	else
 	{
-		fprintf(*fp, "Arguments: <ip> <port> <time_limit> <filename> \n");
+		fprintf(stderr, "Arguments: <ip> <port> <time_limit> <filename> [margin=<ms>] [hash=<MB>] [ordering=0|1] "
+						"[endgame=<empties>] [split=<plies>] [threads=<n>] [ponder=0|1] [sync=<n>] [pvs=0|1] "
+						"[aspiration=<score>] [speculate=0|1] [shared=<depth>] "
+						"[canonical=<discs>] [games=<n>] [fit=<depth>] [patterns=<file>] [probcut=<file>] [book=<file>] "
+						"[trace=<file>]\n"
+						"       bench <positions|selfplay> <time_limit> <filename> [options]\n"
+						"With games=<n> the games share one search: all ranks search one gen_move at a time, oldest "
+						"first\n");
 	}
 
 	return result;
 }
 
-void initialise_board()
+/**
+ * @brief Parses an optional name=value argument following the required ones.
+ * - margin: milliseconds of the time limit kept back as a safety margin
+ * - hash: megabytes of transposition table on each searching rank
+ * - ordering: 0 searches moves in square order, to measure what move ordering saves
+ * - endgame: solve exactly once this many squares are empty, 0 to never solve
+ * - split: plies of the tree split among the workers, 1 hands out only the root moves
+ * - threads: search threads on each searching rank, they share the rank's transposition table
+ * - ponder: 1 keeps all ranks searching the opponent's replies until the referee sends its next command
+ * - sync: n > 0 broadcasts only the moves since the last board, checking every n-th time that all ranks agree on it
+ * - pvs: 0 searches every move with the full window, to measure what the null window searches save
+ * - aspiration: how far from the score of the last iteration the root window reaches, 0 for a full window
+ * - speculate: 1 has workers with nothing left to do in an iteration search the opponent's likeliest replies
+ * - shared: nodes searched at least this deep also go to a table distributed over all ranks, each rank owning hash
+ *   megabytes of it, 0 for none
+ * - canonical: positions with at most this many discs are kept in the transposition table the way round
+ *   bb_canonical turns them, so that mirror images share an entry, 0 for never
+ * - games: n > 0 plays n games at once on connections of their own to the referee, each connection going on to the
+ *   next game when one ends until the referee takes no more. The games share one search rather than a pool of
+ *   workers each: all ranks search for whichever game sent its gen_move first, one at a time, so more games keep
+ *   the ranks busy between moves but search no more at once, and ponder is off. Each game logs to the file name with
+ *   .i appended, and its result, or a connection that could not start its next game, goes to the file itself
+ * - fit: a benchmark also writes the score pairs ProbCut is fitted on to the log for every position, from depths up
+ *   to this one, and searches without ProbCut; see fit_probcut. 0 for none
+ * - patterns: weights file for the pattern evaluator, used instead of evaluate at the leaves
+ * - probcut: file of ProbCut fits written by tools/fit_probcut.c, with which null window nodes are cut short when a
+ *   shallow search says a full one would very likely fail high or low
+ * - book: opening book file, see tools/make_book.c
+ * - trace: file name for an event trace of every rank, see trace.h and tools/trace_to_json.c
+ *
+ * @param option
+ * @return int
+ */
+int parse_option(char *option)
 {
-	int i;
-	board = (int *)malloc(BOARDSIZE * sizeof(int));
-	for (i = 0; i <= 9; i++)
-		board[i] = OUTER;
-	for (i = 10; i <= 89; i++)
+	char *value = strchr(option, '=');
+	char *end;
+	long number;
+
+	if (value == NULL)
+		return FAILURE;
+	value++;
+	if (strncmp(option, "patterns=", value - option) == 0)
 	{
-		if (i % 10 >= 1 && i % 10 <= 8)
-			board[i] = EMPTY;
-		else
-			board[i] = OUTER;
+		if (*value == '\0' || strlen(value) >= sizeof(opts.patterns))
+			return FAILURE;
+		strcpy(opts.patterns, value);
+		return SUCCESS;
 	}
-	for (i = 90; i <= 99; i++)
-		board[i] = OUTER;
-	board[44] = WHITE;
-	board[45] = BLACK;
-	board[54] = BLACK;
-	board[55] = WHITE;
-}
-
-void free_board()
-{
-	free(board);
+	if (strncmp(option, "probcut=", value - option) == 0)
+	{
+		if (*value == '\0' || strlen(value) >= sizeof(opts.probcut))
+			return FAILURE;
+		strcpy(opts.probcut, value);
+		return SUCCESS;
+	}
+	if (strncmp(option, "book=", value - option) == 0)
+	{
+		if (*value == '\0' || strlen(value) >= sizeof(opts.book))
+			return FAILURE;
+		strcpy(opts.book, value);
+		return SUCCESS;
+	}
+	if (strncmp(option, "trace=", value - option) == 0)
+	{
+		if (*value == '\0' || strlen(value) >= sizeof(opts.trace))
+			return FAILURE;
+		strcpy(opts.trace, value);
+		return SUCCESS;
+	}
+	errno = 0;
+	number = strtol(value, &end, 10);
+	if (errno != 0 || end == value || *end != '\0')
+		return FAILURE;
+
+	if (strncmp(option, "margin=", value - option) == 0 && number >= 0)
+		opts.margin = number;
+	else if (strncmp(option, "hash=", value - option) == 0 && number > 0 && number <= 65536)
+		opts.hash = number;
+	else if (strncmp(option, "ordering=", value - option) == 0 && (number == 0 || number == 1))
+		opts.ordering = number;
+	else if (strncmp(option, "endgame=", value - option) == 0 && number >= 0 && number < BB_SQUARES)
+		opts.endgame = number;
+	else if (strncmp(option, "split=", value - option) == 0 && number >= 1 && number <= MAXSPLITPLY)
+		opts.split = number;
+	else if (strncmp(option, "threads=", value - option) == 0 && number >= 1 && number <= MAXTHREADS)
+		opts.threads = number;
+	else if (strncmp(option, "ponder=", value - option) == 0 && (number == 0 || number == 1))
+		opts.ponder = number;
+	else if (strncmp(option, "sync=", value - option) == 0 && number >= 0)
+		opts.sync = number;
+	else if (strncmp(option, "pvs=", value - option) == 0 && (number == 0 || number == 1))
+		opts.pvs = number;
+	else if (strncmp(option, "aspiration=", value - option) == 0 && number >= 0 && number < WIN_SCORE)
+		opts.aspiration = number;
+	else if (strncmp(option, "speculate=", value - option) == 0 && (number == 0 || number == 1))
+		opts.speculate = number;
+	else if (strncmp(option, "shared=", value - option) == 0 && number >= 0 && number < MAXPLY)
+		opts.shared = number;
+	else if (strncmp(option, "canonical=", value - option) == 0 && number >= 0 && number <= BB_SQUARES)
+		opts.canonical = number;
+	else if (strncmp(option, "games=", value - option) == 0 && number >= 0 && number <= MAXCONNECTIONS)
+		opts.games = number;
+	else if (strncmp(option, "fit=", value - option) == 0 && number >= 0 && number < MAXPLY)
+		opts.fit = number;
+	else
+		return FAILURE;
+	return SUCCESS;
 }
 
-/* The copyboard function mallocs space for a board, then copies
-   the values of a given board to the newly malloced board.
-*/
-
-int *copy_board(int *board)
+/**
+ * @brief Commits board_type, the MPI datatype of a board_message
+ */
+void create_board_type()
 {
-	int *new_board;
-	new_board = (int *)malloc(BOARDSIZE * sizeof(int));
-	for (int i = 0; i < BOARDSIZE; i++)
-	{
-		new_board[i] = board[i];
-	}
-	return new_board;
+	int lengths[2] = {3, 4};
+	MPI_Aint offsets[2] = {offsetof(board_message, discs), offsetof(board_message, mover)};
+	MPI_Datatype types[2] = {MPI_UINT64_T, MPI_INT32_T};
+	MPI_Datatype packed;
+
+	MPI_Type_create_struct(2, lengths, offsets, types, &packed);
+	MPI_Type_create_resized(packed, 0, sizeof(board_message), &board_type);
+	MPI_Type_free(&packed);
+	MPI_Type_commit(&board_type);
 }
 
 /**
- *   Rank i (i != 0) executes this code
- *   ----------------------------------
- *   Called at the start of execution on all ranks except for rank 0.
- *   - run_worker should play minimax from its move(s)
- *   - results should be send to Rank 0 for final selection of a move
+ * @brief Broadcasts the board from rank 0, together with flags, the side to move and the budget of the search that
+ * follows, in one collective. At the other ranks the arguments are ignored and the board arrives in board. Every
+ * rank has the budget in budget, the side to move in root_mover and the side of rank 0 in my_colour afterwards, and
+ * gets the flags back.
+ *
+ * With opts.sync the other ranks are sent only the moves made since the last board and make them on their own
+ * copy, unless there were more than MAXSYNCMOVES. Every opts.sync-th board rank 0 sends its key along, and if any
+ * rank has a board with another key, the whole board is sent after all.
+ *
+ * @param flags
+ * @param mover
+ * @param budget
+ * @return int
  */
-void run_worker()
+int broadcast_board(int flags, int mover, int *budget)
 {
-	running = 0;
-	int terminated = FALSE;
-	int move;
-	score_result score_result;
-	// Broadcast colour
-	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	// Broadcast running
-	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	// result = malloc(2 * sizeof(int));
+	board_message message;
+	int bit, square, i, move, wrong, resend;
 
-	while (running == 1)
+	if (rank == 0)
 	{
-		// Broadcast board
-		MPI_Bcast(board, BOARDSIZE, MPI_INT, 0, MPI_COMM_WORLD);
-		// Generate move
-		MPI_Status status;
-		while (!terminated)
+		memset(&message, 0, sizeof(board_message));
+		if (opts.sync > 0 && sync_count <= MAXSYNCMOVES)
 		{
-			MPI_Recv(&move, 1, MPI_INT, 0, 100, MPI_COMM_WORLD, &status);
-			score_result.move = move;
-
-			if (move != -1)
+			flags |= BOARD_DELTA;
+			for (i = 0; i < sync_count; i++)
 			{
-
-				score_result.result = minimax(move, my_colour, board, fp);
-
-				MPI_Send(&score_result, 1, MPI_2INT, 0, 105, MPI_COMM_WORLD);
+				message.discs[i / 8] |= (uint64_t)sync_moves[i] << (i % 8 * 8);
 			}
-			else
+		}
+		else
+		{
+			for (bit = 0; bit < BB_SQUARES; bit++)
 			{
-
-				break;
+				square = bb_to_square(bit);
+				if (board[square] == BLACK)
+					message.discs[0] |= BB_BIT(bit);
+				else if (board[square] == WHITE)
+					message.discs[1] |= BB_BIT(bit);
 			}
 		}
-
-		// Broadcast running
-		MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		if (opts.sync > 0 && ++boards_sent % opts.sync == 0)
+		{
+			flags |= BOARD_CHECK;
+			message.check = board_key(fp);
+		}
+		sync_count = 0;
+		message.mover = mover;
+		message.colour = my_colour;
+		message.flags = flags;
+		message.budget = *budget;
+	}
+	MPI_Bcast(&message, 1, board_type, 0, MPI_COMM_WORLD);
+	if (rank != 0 && (message.flags & BOARD_DELTA))
+	{
+		for (i = 0; i < MAXSYNCMOVES; i++)
+		{
+			move = (message.discs[i / 8] >> (i % 8 * 8)) & 0xff;
+			if (move == 0)
+				break;
+			make_move(bb_to_square(move & 0x3f), (move & 0x40) ? WHITE : BLACK, fp);
+		}
+	}
+	else if (rank != 0)
+	{
+		for (bit = 0; bit < BB_SQUARES; bit++)
+		{
+			square = bb_to_square(bit);
+			if (message.discs[0] & BB_BIT(bit))
+				board[square] = BLACK;
+			else if (message.discs[1] & BB_BIT(bit))
+				board[square] = WHITE;
+			else
+				board[square] = EMPTY;
+		}
+	}
+	if (message.flags & BOARD_CHECK)
+	{
+		wrong = rank != 0 && board_key(fp) != message.check;
+		if (wrong)
+		{
+			fprintf(stderr, "Rank %d has lost track of the board, it is sent again\n", rank);
+		}
+		MPI_Allreduce(&wrong, &resend, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+		if (resend)
+		{
+			sync_count = MAXSYNCMOVES + 1;
+			return broadcast_board(flags & ~(BOARD_DELTA | BOARD_CHECK), mover, budget);
+		}
 	}
+	root_mover = message.mover;
+	my_colour = message.colour;
+	*budget = message.budget;
+	return message.flags;
 }
 
 /**
- *  Rank 0 executes this code:
- *  --------------------------
- *  Called when the next move should be generated
- *  - gen_move_master should play minimax from its move(s)
- *  - the ranks may communicate during execution
- *  - final results should be gathered at rank 0 for final selection of a move
+ * @brief Returns the Zobrist key of board, which is how ranks check that they have the same board
+ *
+ * @param fp
+ * @return uint64_t
  */
-void gen_move_master(char *move, int my_colour, FILE *fp)
+uint64_t board_key(FILE *fp)
 {
-	MPI_Status status;
-	int loc, run, i, moves_sent;
-	int moves_rec;
-	int *rec_Moves, *rec_Scores;
-	int best_score, best_move;
-	score_result score_result;
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-	// Obtains the legal moves to be shared among the other processes
-	legal_moves(my_colour, moves, fp);
+	position pos;
 
-	rec_Moves = (int *)malloc(moves[0] * sizeof(int));
-	rec_Scores = (int *)malloc(moves[0] * sizeof(int));
+	load_position(board, &pos, fp);
+	return pos.key;
+}
+
+/**
+ * @brief Sets up the Zobrist keys, the transposition table, the helper threads and the pattern weights, and at rank
+ * 0 the bookkeeping of the split search. The table lives for the whole game, so every gen_move starts from what the
+ * earlier ones left behind.
+ */
+void initialise_search()
+{
+	char path[sizeof(opts.trace) + 16];
+	int r;
 
-	moves_sent = 0;
-	moves_rec = 0;
-	loc = 0;
+	create_board_type();
+	zobrist_init();
+	main_search.log = fp;
+	if (tt_init(opts.hash) == FAILURE)
+	{
+		fprintf(stderr, "Rank %d could not allocate a %d MB transposition table\n", rank, opts.hash);
+	}
+	if (opts.shared > 0 && tt_share(opts.hash) == FAILURE)
+	{
+		if (rank == 0)
+			fprintf(stderr, "Could not allocate the distributed transposition table, searching without it\n");
+		opts.shared = 0;
+	}
+	start_helpers(&main_pool);
 
-	// Run the program if serial if one thread is specified otherwise run the program in parallel.
+	if (opts.trace[0] != '\0')
+	{
+		snprintf(path, sizeof(path), "%s.%d", opts.trace, rank);
+		// The traces of all ranks start together, so that they share a time line
+		MPI_Barrier(MPI_COMM_WORLD);
+		if (trace_open(path, rank) == FAILURE)
+			fprintf(stderr, "Rank %d could not write its trace to %s\n", rank, path);
+	}
 
-	if (size == 1)
+	// Rank 0 reads the pattern weights and sends them to the other ranks
+	if (opts.patterns[0] != '\0')
+	{
+		if (rank == 0)
+		{
+			use_patterns = pattern_load(opts.patterns) == SUCCESS;
+			if (!use_patterns)
+				fprintf(stderr, "Could not load pattern weights from %s, using evaluate\n", opts.patterns);
+		}
+		MPI_Bcast(&use_patterns, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		if (use_patterns && rank != 0 && pattern_alloc() == FAILURE)
+		{
+			fprintf(stderr, "Rank %d could not allocate the pattern weights\n", rank);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		if (use_patterns)
+			MPI_Bcast(pattern_weights(), pattern_weight_count(), MPI_INT16_T, 0, MPI_COMM_WORLD);
+	}
+	// The same for the ProbCut fits, which a benchmark fitting new ones does without
+	if (opts.probcut[0] != '\0')
+	{
+		if (rank == 0)
+		{
+			use_probcut = load_probcut(opts.probcut) == SUCCESS;
+			if (!use_probcut)
+				fprintf(stderr, "Could not load ProbCut fits from %s, searching without them\n", opts.probcut);
+			use_probcut = use_probcut && opts.fit == 0;
+		}
+		MPI_Bcast(&use_probcut, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		if (use_probcut)
+			MPI_Bcast(probcut, sizeof(probcut), MPI_BYTE, 0, MPI_COMM_WORLD);
+	}
+	if (rank == 0)
 	{
-		loc = serial(move, my_colour, fp);
-		best_move = loc;
+		worker_node = (int *)malloc(size * sizeof(int));
+		worker_child = (int *)malloc(size * sizeof(int));
+		worker_job = (int *)malloc(size * sizeof(int));
+		worker_alpha = (int *)malloc(size * sizeof(int));
+		worker_beta = (int *)malloc(size * sizeof(int));
+		worker_start = (double *)malloc(size * sizeof(double));
+		worker_result = (job_result *)malloc(size * sizeof(job_result));
+		worker_request = (MPI_Request *)malloc(size * sizeof(MPI_Request));
+		worker_reply = (int *)malloc(size * sizeof(int));
+		worker_blocked = (int *)malloc(size * sizeof(int));
+		for (r = 1; r < size; r++)
+		{
+			worker_reply[r] = -1;
+			MPI_Recv_init(&worker_result[r], sizeof(job_result) / sizeof(int), MPI_INT, r, 105, MPI_COMM_WORLD,
+						  &worker_request[r]);
+		}
 	}
+}
+
+double monotonic_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Starts the clock of ctx for a move. budget is the number of milliseconds the search may use, or negative
+ * for no deadline. The deadline is kept per rank on its own clock, so ranks on other nodes need no common time base.
+ *
+ * @param ctx
+ * @param budget
+ */
+void set_deadline(search_context *ctx, int budget)
+{
+	if (budget < 0)
+		ctx->limits->deadline = 0;
 	else
+		ctx->limits->deadline = monotonic_time() + budget / 1000.0;
+	ctx->aborted = FALSE;
+	search_number++;
+}
+
+int time_up(search_limits *limits)
+{
+	return limits->deadline > 0 && monotonic_time() >= limits->deadline;
+}
+
+void initialise_board()
+{
+	board = (int *)malloc(BOARDSIZE * sizeof(int));
+	reset_board(board);
+}
+
+/* Sets board up in the starting position */
+void reset_board(int *board)
+{
+	int i;
+	for (i = 0; i <= 9; i++)
+		board[i] = OUTER;
+	for (i = 10; i <= 89; i++)
 	{
+		if (i % 10 >= 1 && i % 10 <= 8)
+			board[i] = EMPTY;
+		else
+			board[i] = OUTER;
+	}
+	for (i = 90; i <= 99; i++)
+		board[i] = OUTER;
+	board[44] = WHITE;
+	board[45] = BLACK;
+	board[54] = BLACK;
+	board[55] = WHITE;
+}
+
+void free_board()
+{
+	free(board);
+}
+
+/**
+ *   Rank i (i != 0) executes this code
+ *   ----------------------------------
+ *   Called at the start of execution on all ranks except for rank 0.
+ *   - run_worker should play minimax from its move(s)
+ *   - results should be send to Rank 0 for final selection of a move
+ */
+void run_worker()
+{
+	int budget;
+	double wait_start;
+	search_job job;
+	bound_update update;
+	job_result result;
+	int stop;
+	// Broadcast colour
+	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	// Broadcast the options
+	MPI_Bcast(&opts, sizeof(options), MPI_BYTE, 0, MPI_COMM_WORLD);
+	initialise_search();
 
-		// Loop through the available processes
-		for (i = 1; i < size; i++)
+	// Broadcast board, with the time left for this move
+	while (broadcast_board(0, 0, &budget) & BOARD_RUNNING)
+	{
+		set_deadline(&main_search, budget);
+		tt_new_search();
+		age_history(&main_search);
+		reset_stats();
+		trace_event(TRACE_SEARCH_START, root_mover);
+		// Generate move
+		MPI_Status status;
+		while (TRUE)
 		{
-			// Checks if the moves_sent to the processes are all sent and if it is terminate the loop
-			if (moves_sent == moves[0])
+			wait_start = monotonic_time();
+			trace_event(TRACE_IDLE_START, 0);
+			MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+			trace_event(TRACE_IDLE_END, 0);
+			idle_time += monotonic_time() - wait_start;
+			// Bounds and stops for a job that has already been answered are thrown away
+			if (status.MPI_TAG == 110)
 			{
-				break;
+				MPI_Recv(&update, 3, MPI_INT, 0, 110, MPI_COMM_WORLD, &status);
+				continue;
 			}
-			/*
-			This if else statement forces the player to play the corner move regardless of
-			the evalualtion. Hence making the algorithm stronger.
-			*/
-			if (moves[i] == 11)
+			if (status.MPI_TAG == 115)
 			{
-				loc = moves[i];
+				MPI_Recv(&stop, 1, MPI_INT, 0, 115, MPI_COMM_WORLD, &status);
+				continue;
 			}
-			else if (moves[i] == 18)
+			// A job is a subtree to search, or an id of -1 once the move is decided
+			MPI_Recv(&job, sizeof(search_job) / sizeof(int), MPI_INT, 0, 100, MPI_COMM_WORLD, &status);
+			if (job.id == -1)
+			{
+				break;
+			}
+			run_job(&job, &result, &main_search);
+
+			MPI_Send(&result, sizeof(job_result) / sizeof(int), MPI_INT, 0, 105, MPI_COMM_WORLD);
+			trace_event(TRACE_RESULT_SENT, result.id);
+		}
+		trace_event(TRACE_SEARCH_END, 0);
+		// The counts of the gen_move go to rank 0
+		gather_stats(NULL, NULL, NULL);
+		// Nothing is searched until the next board, so the trace is written out now
+		trace_flush();
+	}
+}
+
+/**
+ * @brief Searches the board for my_colour as the referee's gen_move asks for: broadcasts it to every rank with the
+ * time left for the move, from which each rank keeps its own deadline, and plays the move gen_move_master finds.
+ * With opts.games the time the gen_move waited for the other games is not left.
+ *
+ * @param move
+ * @param fp
+ */
+void search_move(char *move, FILE *fp)
+{
+	int budget = -1;
+
+	if (time_limit > 0)
+	{
+		budget = time_limit * 1000 - opts.margin - (int)(command_wait * 1000);
+		if (budget < 0)
+			budget = 0;
+	}
+	broadcast_board(BOARD_RUNNING, my_colour, &budget);
+	set_deadline(&main_search, budget);
+	tt_new_search();
+	age_history(&main_search);
+	reset_stats();
+	trace_event(TRACE_SEARCH_START, root_mover);
+
+	gen_move_master(move, my_colour, fp);
+	trace_event(TRACE_SEARCH_END, 0);
+}
+
+/**
+ * @brief Plays the benchmark given instead of the referee's address. Each position of the file bench_positions is
+ * searched as a gen_move with the same time limit and reported on one line by report_stats, along with whether the
+ * move found is the one the file expects. With "selfplay" a whole game is played from the starting position
+ * instead, both sides searched by this engine, each move reported the same way and the final disc counts last.
+ * With opts.fit every position is first written out for fitting ProbCut by fit_probcut.
+ *
+ * @param fp
+ */
+void run_benchmark(FILE *fp)
+{
+	FILE *in;
+	char line[CMDBUFSIZE];
+	char move[MOVEBUFSIZE];
+	int passes;
+
+	if (strcmp(bench_positions, "selfplay") == 0)
+	{
+		bench_expected[0] = '\0';
+		my_colour = BLACK;
+		for (passes = 0; passes < 2; my_colour = opponent(my_colour, fp))
+		{
+			bench_position++;
+			if (opts.fit > 0)
+				fit_probcut(fp);
+			search_move(move, fp);
+			trace_flush();
+			passes = strcmp(move, "pass\n") == 0 ? passes + 1 : 0;
+		}
+		fprintf(fp, "{\"black\": %d, \"white\": %d}\n", count(BLACK, board), count(WHITE, board));
+		fflush(fp);
+		return;
+	}
+
+	in = fopen(bench_positions, "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, "File %s could not be opened\n", bench_positions);
+		return;
+	}
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (load_bench_position(line) == FAILURE)
+		{
+			fprintf(stderr, "Skipping the position %s", line);
+			continue;
+		}
+		bench_position++;
+		if (opts.fit > 0)
+			fit_probcut(fp);
+		search_move(move, fp);
+		trace_flush();
+	}
+	fclose(in);
+}
+
+/**
+ * @brief Sets up the board, my_colour and bench_expected from a line of a benchmark file: the 64 squares row by row
+ * from the top left corner as b, w or . like print_board shows them, the side to move as b or w, and optionally the
+ * move expected of it as the referee would send it, or pass.
+ *
+ * @param line
+ * @return int
+ */
+int load_bench_position(char *line)
+{
+	char squares[CMDBUFSIZE], side, expected[CMDBUFSIZE];
+	int n, bit, square;
+
+	n = sscanf(line, "%99s %c %99s", squares, &side, expected);
+	if (n < 2 || strlen(squares) != BB_SQUARES || strspn(squares, "bw.") != BB_SQUARES || (side != 'b' && side != 'w'))
+		return FAILURE;
+	if (n == 3 && strcmp(expected, "pass") != 0 &&
+		(strlen(expected) != 2 || strspn(expected, "01234567") != 2))
+		return FAILURE;
+
+	for (bit = 0; bit < BB_SQUARES; bit++)
+	{
+		square = bb_to_square(bit);
+		board[square] = squares[bit] == 'b' ? BLACK : squares[bit] == 'w' ? WHITE : EMPTY;
+	}
+	my_colour = side == 'b' ? BLACK : WHITE;
+	bench_expected[0] = '\0';
+	if (n == 3)
+		snprintf(bench_expected, MOVEBUFSIZE, "%s\n", expected);
+	// The workers cannot follow the board from the moves made on it, they are sent all of it
+	sync_count = MAXSYNCMOVES + 1;
+	return SUCCESS;
+}
+
+/**
+ * @brief Writes the score pairs ProbCut is fitted on to fp, for the board with my_colour to move. Every move is
+ * searched on its own at rank 0 with a full window to each depth from PROBCUT_MIN_DEPTH to opts.fit and to half of
+ * it, the shallow depth ProbCut tests it at, each time from an empty transposition table. Each pair goes on a line of
+ * its own, with the game_stage of the board after the move and both scores from the side to move there, for
+ * tools/fit_probcut.c. Depths the exact solver would take over at and scores of games decided within the depth are
+ * left out, as ProbCut is never tried on them.
+ *
+ * @param fp
+ */
+void fit_probcut(FILE *fp)
+{
+	int moves[LEGALMOVSBUFSIZE];
+	int i, depth, shallow, deep_score, shallow_score, sign, empties, opp;
+	position pos;
+
+	opp = opponent(my_colour, fp);
+	legal_moves(my_colour, moves, fp);
+	set_deadline(&main_search, -1);
+	for (i = 1; i <= moves[0]; i++)
+	{
+		load_position(board, &pos, fp);
+		make_position_move(&pos, moves[i], my_colour, fp);
+		// The searches score for my_colour, the fit for whoever moves next, which is my_colour again after a pass
+		if (bb_moves(pos.discs[opp], pos.discs[my_colour]) != 0)
+			sign = -1;
+		else if (bb_moves(pos.discs[my_colour], pos.discs[opp]) != 0)
+			sign = 1;
+		else
+			continue;
+		empties = BB_SQUARES - bb_count(pos.discs[BLACK] | pos.discs[WHITE]);
+		for (depth = PROBCUT_MIN_DEPTH; depth <= opts.fit; depth++)
+		{
+			if (depth >= empties && empties <= opts.endgame && game_stage(&pos) == 3)
+				break;
+			shallow = depth / 2;
+			// Each search starts from an empty table, or the shallow one would find the scores of deeper ones
+			tt_clear();
+			deep_score = minimax(moves[i], my_colour, depth, -INFINITY_SCORE, INFINITY_SCORE, board, &main_search);
+			tt_clear();
+			shallow_score = minimax(moves[i], my_colour, shallow, -INFINITY_SCORE, INFINITY_SCORE, board, &main_search);
+			if (abs(deep_score) >= WIN_SCORE || abs(shallow_score) >= WIN_SCORE)
+				continue;
+			fprintf(fp, "{\"probcut\": {\"stage\": %d, \"depth\": %d, \"shallow_depth\": %d, \"shallow\": %d, "
+						"\"deep\": %d}}\n",
+					game_stage(&pos), depth, shallow, sign * shallow_score, sign * deep_score);
+		}
+	}
+	fflush(fp);
+}
+
+/**
+ *  Rank 0 executes this code:
+ *  --------------------------
+ *  Called when the next move should be generated
+ *  - gen_move_master should play minimax from its move(s)
+ *  - the ranks may communicate during execution
+ *  - final results should be gathered at rank 0 for final selection of a move
+ *
+ *  The root moves are searched by iterative deepening until the deadline set from the time limit. The move
+ *  played is the best move of the last iteration that finished; an iteration cut short by the deadline is thrown
+ *  away, except that the best of the moves it did finish is played if it finished the best move so far. Without a
+ *  time limit a single iteration to dynamic_depth is searched.
+ *
+ *  Every iteration after the first is searched with an aspiration window of opts.aspiration around the score of
+ *  the one before. If the score falls outside it, the iteration is searched again with the window open on that
+ *  side, and a move that fails high is played if the search again runs out of time.
+ *
+ *  Within opts.endgame empties the search jumps from a heuristic iteration straight to the exact one to depth
+ *  empties, but only once that is expected to finish in the time left; after it there is nothing left to search.
+ */
+void gen_move_master(char *move, int my_colour, FILE *fp)
+{
+	int loc, i;
+	int depth, max_depth, best_move, iteration_move, empties, depth_reached, alpha, beta, score;
+	int moves[LEGALMOVSBUFSIZE], scores[LEGALMOVSBUFSIZE];
+	uint64_t legal;
+	double start = monotonic_time();
+	double iteration_start, growth, estimate;
+	search_job last_job = {.id = -1};
+	move_number++;
+	// Obtains the legal moves to be shared among the other processes
+	legal_moves(my_colour, moves, fp);
+	load_position(board, &main_search.stack[0], fp);
+	if (opts.ordering)
+	{
+		// Hands out the most promising root moves first
+		legal = bb_moves(main_search.stack[0].discs[my_colour],
+						 main_search.stack[0].discs[opponent(my_colour, fp)]);
+		moves[0] = order_moves(&main_search.stack[0], legal, my_colour, 0, 0, &moves[1], &main_search);
+	}
+	moves[0] = drop_symmetric_moves(&main_search.stack[0], my_colour, moves, fp);
+
+	best_move = -1;
+	depth_reached = 0;
+	makespan = 0;
+	speculation_move = -1;
+	memset(move_cost, 0, sizeof(move_cost));
+	if (moves[0] > 0)
+	{
+		// A fallback in case not even the first iteration finishes in time
+		best_move = moves[1];
+		empties = BB_SQUARES - count(BLACK, board) - count(WHITE, board);
+		if (main_limits.deadline > 0)
+		{
+			depth = 1;
+			max_depth = empties;
+		}
+		else
+		{
+			depth = max_depth = dynamic_depth(moves[0]);
+		}
+
+		alpha = -INFINITY_SCORE;
+		beta = INFINITY_SCORE;
+		for (; depth <= max_depth; depth++)
+		{
+			iteration_start = monotonic_time();
+			// Run the program if serial if one thread is specified otherwise run the program in parallel.
+			if (size == 1)
 			{
-				loc = moves[i];
+				iteration_move = serial(moves, scores, depth, alpha, beta);
 			}
-			else if (moves[i] == 81)
+			else
 			{
-				loc = moves[i];
+				if (best_move != speculation_move)
+				{
+					// What was searched ahead of time for another move is no use for this one
+					speculation_move = best_move;
+					for (i = 1; i < size; i++)
+						worker_reply[i] = -1;
+				}
+				iteration_move = split_search(moves, scores, depth, alpha, beta, fp);
 			}
-			else if (moves[i] == 88)
+
+			if (iteration_move == -1)
 			{
-				loc = moves[i];
+				// The moves the iteration did finish were searched deeper than in the one before
+				if (partial_move != -1 && moves[1] == best_move)
+					best_move = partial_move;
+				break;
 			}
-			/*
-				Send the moves out inititially to the processes
-			*/
-			MPI_Send(&moves[i], 1, MPI_INT, i, 100, MPI_COMM_WORLD);
-			moves_sent++;
-		}
-		/* Another termination if statement, used to check if the moves_amt is greater than zero, and if it is not
-			then set the run flag to -1 and sends a termination signal to the run_worker while loop which if the moves_amt
-			is less than 0 will terminate the loop and send a pass.
-		*/
-		if (moves[0] <= 0)
-		{
-			run = -1;
-			for (i = 1; i < size; i++)
+			score = -INFINITY_SCORE;
+			for (i = 1; i <= moves[0]; i++)
 			{
-				MPI_Send(&run, 1, MPI_INT, i, 100, MPI_COMM_WORLD);
+				if (scores[i] > score)
+					score = scores[i];
 			}
-			strncpy(move, "pass\n", MOVEBUFSIZE);
-		}
-		/*
-		This while loop is used to give dynamic work load balancing. It is used for when a score is sent back that
-		it will give a processes more work if it has completed its job.
-		*/
-		int finished = FALSE;
-		int flag;
-		while (!finished)
-		{
-			/*The Iprobe is used to 'probe' for any signals on the tag of 105 which is where the results of the minimax
-			gets sent from the run_worker*/
-			MPI_Iprobe(MPI_ANY_SOURCE, 105, MPI_COMM_WORLD, &flag, &status);
-
-			/*The loop blocks until it receives result data from run_worker, basically process 0 is waiting for its
-				workers (run_worker) to send it its results from computing the minimax.
-			*/
-			if (flag == 1)
+			if (score <= alpha || score >= beta)
 			{
-				/*The process zero receives the result from the minimax struct in the run_worker function from the relevant
-					MPI_send in run_worker once the specific process has executed the minimax.
-				*/
-				MPI_Recv(&score_result, 1, MPI_2INT, MPI_ANY_SOURCE, 105, MPI_COMM_WORLD, &status);
-				/*
-				Stores the result of the move computed by the workers in the rec_Moves and
-				stores the actual result in the rec_scores array.
-				then increases the amount of moves received.
-				*/
-				rec_Moves[moves_rec] = score_result.move;
-				rec_Scores[moves_rec] = score_result.result;
-				moves_rec++;
-
-				/*
-				Checks if all the moves received are equal to all the moves that are available and if they are
-				sets the run flag to -1 and sends the signal to terminate to the workers.
-				*/
-				if (moves_rec == moves[0])
+				if (score <= alpha)
 				{
-					run = -1;
-					for (i = 1; i < size; i++)
-					{
-						MPI_Send(&run, 1, MPI_INT, i, 100, MPI_COMM_WORLD);
-					}
-					break;
+					alpha = -INFINITY_SCORE;
 				}
-				else if (moves_sent < moves[0])
+				else
 				{
-					// Fixed the broken termination
-					moves_sent++;
-					MPI_Send(&moves[moves_sent], 1, MPI_INT, status.MPI_SOURCE, 100, MPI_COMM_WORLD);
+					beta = INFINITY_SCORE;
+					best_move = iteration_move;
 				}
+				depth--;
+				continue;
+			}
+			best_move = iteration_move;
+			depth_reached = depth;
+			// How much longer this iteration took than the one before, for the prediction of an exact solve
+			growth = makespan > 0 ? (monotonic_time() - iteration_start) / makespan : 0;
+			if (growth < ENDGAME_MIN_GROWTH)
+				growth = ENDGAME_MIN_GROWTH;
+			makespan = monotonic_time() - iteration_start;
+			// The next iteration starts with the moves that scored best in this one
+			if (opts.ordering)
+			{
+				sort_moves(moves, scores);
 			}
-		}
 
-		best_score = -2000;
-		best_move = rec_Moves[0];
-		/*
-		Loops through the moves received from the workers and updates the best move and score based on which one is greater
-		than each other.
-		*/
-		for (i = 0; i < moves_rec; i++)
-		{
-			if (rec_Scores[i] > best_score)
+			// The iteration to depth empties is exact, nothing deeper is left to search
+			if (depth == max_depth || time_up(&main_limits))
+			{
+				break;
+			}
+			if (opts.aspiration > 0)
 			{
-				best_score = rec_Scores[i];
-				best_move = rec_Moves[i];
+				alpha = score - opts.aspiration;
+				beta = score + opts.aspiration;
+			}
+			/*
+			Close enough to the end the next iteration goes all the way: searched to depth empties, every node
+			with few enough empties is handed to the exact solver. It is only started if the time of this
+			iteration, grown at the rate the iterations have been growing for every ply skipped, fits in the
+			time left. That overestimates the solver, which is cheaper per node, so otherwise the heuristic
+			iterations go on and the deepest one to finish is played. Without a time limit there is only the
+			one iteration.
+			*/
+			if (main_limits.deadline > 0 && opts.endgame > 0 && empties <= opts.endgame &&
+				depth >= ENDGAME_PREPARE_DEPTH && depth < max_depth - 1 && game_stage(&main_search.stack[0]) == 3)
+			{
+				estimate = makespan;
+				for (i = depth; i < max_depth && monotonic_time() + estimate < main_limits.deadline; i++)
+					estimate *= growth;
+				if (monotonic_time() + estimate < main_limits.deadline)
+					depth = max_depth - 1;
 			}
 		}
-		// Very important to freeing up memory.
-		free(rec_Moves);
-		free(rec_Scores);
 	}
+
+	/*
+	Sends the termination signal to the run_worker loop, ending this gen_move on the workers.
+	*/
+	for (i = 1; i < size; i++)
+	{
+		MPI_Send(&last_job, sizeof(search_job) / sizeof(int), MPI_INT, i, 100, MPI_COMM_WORLD);
+	}
+
 	// Tell process zero to play the best move received from the workers.
 	loc = best_move;
 
@@ -501,73 +1731,798 @@ void gen_move_master(char *move, int my_colour, FILE *fp)
 		get_move_string(loc, move);
 		make_move(loc, my_colour, fp);
 	}
-	free(moves);
+	// The workers speculated on the replies to another move than the one played
+	if (loc != speculation_move)
+		speculation_move = -1;
+	warm_rank = -1;
+	report_stats(depth_reached, move, monotonic_time() - start, fp);
 }
+
 /**
- * @brief A serial function that runs the minimax algorithm when the threads specified are equal to one
+ * @brief Searches on the opponent's time, right after a move has been sent. Every rank takes part as in a gen_move
+ * without a time limit, with the opponent to move at the root, so that the replies it is most likely to play are
+ * searched deepest. The search is given up as soon as the referee sends its next command, which is left for
+ * run_master to read. Nothing of it is kept but what it left in the transposition tables, which the search of the
+ * next gen_move then starts from.
  *
- * @param move
- * @param my_colour
  * @param fp
- * @return int
  */
-int serial(char *move, int my_colour, FILE *fp)
+void ponder_master(FILE *fp)
 {
-
-	int result, best_score, best_move;
-	int *new_board;
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-	legal_moves(my_colour, moves, fp);
-
-	best_move = -100;
-	best_score = -2000;
-
-	if (moves[0] == 0)
+	int depth, max_depth, i, opp;
+	int moves[LEGALMOVSBUFSIZE], scores[LEGALMOVSBUFSIZE];
+	double start, iteration_start;
+	search_job last_job = {.id = -1};
+	int budget = -1;
+
+	opp = opponent(my_colour, fp);
+	load_position(board, &main_search.stack[0], fp);
+	moves[0] = order_moves(&main_search.stack[0],
+						   bb_moves(main_search.stack[0].discs[opp], main_search.stack[0].discs[my_colour]), opp, 0, 0,
+						   &moves[1], &main_search);
+	// Nothing to ponder if the opponent has to pass or the game is over
+	if (moves[0] == 0 || comms_cmd_waiting(0))
 	{
-		free(moves);
-		return -1;
+		return;
 	}
 
-	new_board = copy_board(board);
-	for (int i = 1; i <= moves[0]; i++)
+	start = monotonic_time();
+	broadcast_board(BOARD_RUNNING, opp, &budget);
+	set_deadline(&main_search, budget);
+	tt_new_search();
+	age_history(&main_search);
+	reset_stats();
+	trace_event(TRACE_SEARCH_START, root_mover);
+
+	pondering = TRUE;
+	makespan = 0;
+	max_depth = BB_SQUARES - count(BLACK, board) - count(WHITE, board);
+	for (depth = 1; depth <= max_depth; depth++)
 	{
-
-		result = minimax(moves[i], my_colour, board, fp);
-		board = copy_board(new_board);
-		make_move(moves[i], my_colour, fp);
-
-		if (result > best_score)
+		iteration_start = monotonic_time();
+		if (split_search(moves, scores, depth, -INFINITY_SCORE, INFINITY_SCORE, fp) == -1)
 		{
-			best_move = moves[i];
-			best_score = result;
+			break;
 		}
+		makespan = monotonic_time() - iteration_start;
+		// Scores are from my side, the opponent's best replies are the lowest
+		for (i = 1; i <= moves[0]; i++)
+		{
+			scores[i] = -scores[i];
+		}
+		sort_moves(moves, scores);
 	}
 
-	free(moves);
-	free(new_board);
-	return best_move;
-}
-
-void apply_opp_move(char *move, int my_colour, FILE *fp)
-{
-	int loc;
-	if (strcmp(move, "pass\n") == 0)
+	for (i = 1; i < size; i++)
 	{
-		return;
+		MPI_Send(&last_job, sizeof(search_job) / sizeof(int), MPI_INT, i, 100, MPI_COMM_WORLD);
 	}
-	loc = get_loc(move);
-	make_move(loc, opponent(my_colour, fp), fp);
+	report_stats(depth - 1, NULL, monotonic_time() - start, fp);
+	trace_event(TRACE_SEARCH_END, 0);
+	pondering = FALSE;
 }
 
-void game_over()
+/**
+ * @brief Looks the board up in the opening book. If it is there the book move is made and written into move and
+ * TRUE is returned, otherwise FALSE.
+ *
+ * @param move
+ * @param my_colour
+ * @param fp
+ * @return int
+ */
+int book_move(char *move, int my_colour, FILE *fp)
 {
-	free_board();
-	MPI_Finalize();
+	uint64_t own, opp;
+	int bit, loc;
+
+	if (opts.book[0] == '\0')
+		return FALSE;
+	get_bitboards(board, my_colour, &own, &opp, fp);
+	bit = book_probe(own, opp);
+	if (bit == -1)
+		return FALSE;
+
+	loc = bb_to_square(bit);
+	get_move_string(loc, move);
+	make_move(loc, my_colour, fp);
+	move_number++;
+	fprintf(fp, "{\"move\": %d, \"book\": true}\n", move_number);
+	fflush(fp);
+	return TRUE;
 }
 
-void get_move_string(int loc, char *ms)
-{
+/**
+ * @brief Searches one iteration at the given depth over all ranks with the root window alpha, beta and returns the
+ * best move, or -1 if the deadline cut the iteration short. The score of moves[i] is left in scores[i], or
+ * -INFINITY_SCORE for a move never searched because an earlier one already reached beta.
+ *
+ * The top opts.split ply of the tree are kept at rank 0 as split nodes; everything below is searched by the workers
+ * as jobs. At every split node the eldest child is searched first, and only once its result is in are the younger
+ * brothers handed out, all of them at once, with the window the eldest left behind. Whenever a result tightens the
+ * window of a split node, the ranks still searching below it are sent the new bounds on tag 110.
+ *
+ * The side to move at the root is root_mover, which is the opponent while pondering.
+ *
+ * Every younger brother at the root has to be searched, so their order matters little for the size of the tree
+ * but a lot for how evenly the ranks finish. Once the last iteration has timed them they are handed out most
+ * costly first, and a root move costing less than its share of the ranks is searched as one job rather than split.
+ *
+ * With opts.speculate the workers the iteration leaves idle once the root moves are all handed out search ahead of
+ * time instead, see speculate. They are stopped as soon as the iteration has work for them, and once it is over.
+ *
+ * @param moves
+ * @param scores
+ * @param depth
+ * @param alpha
+ * @param beta
+ * @param fp
+ * @return int
+ */
+int split_search(int *moves, int *scores, int depth, int alpha, int beta, FILE *fp)
+{
+	MPI_Status status;
+	split_node *root;
+	job_result result;
+	struct timespec pause = {0, WAIT_POLL_MS * 1000000L};
+	double wait_start;
+	int i, r, flag;
+
+	aborting = FALSE;
+	root_done = FALSE;
+	partial_move = -1;
+	idle_ranks = size;
+	for (r = 0; r < size; r++)
+	{
+		worker_node[r] = -1;
+		worker_blocked[r] = FALSE;
+	}
+	// An abandoned iteration leaves its split nodes open
+	for (i = 0; i < MAXSPLITNODES; i++)
+	{
+		split_nodes[i].in_use = FALSE;
+	}
+
+	root = &split_nodes[0];
+	memset(root, 0, sizeof(split_node));
+	root->in_use = TRUE;
+	root->parent = -1;
+	load_position(board, &root->pos, fp);
+	root->mover = root_mover;
+	root->depth = depth;
+	root->alpha = alpha;
+	root->beta = beta;
+	root->best_move = moves[1];
+	memcpy(root->moves, moves, (moves[0] + 1) * sizeof(int));
+	memset(iteration_cost, 0, sizeof(iteration_cost));
+	if (!pondering)
+	{
+		order_by_cost(root->moves);
+	}
+
+	schedule(fp);
+	/*
+	This while loop is used to give dynamic work load balancing. Whenever a score is sent back, the rank that sent
+	it is given the next piece of work that is ready. Rank 0 searches jobs of its own as well, answering the workers
+	whenever it looks at the clock; with nothing of its own to search it sleeps in MPI_Waitany until a result comes
+	in. The workers keep to the deadline on their own clocks, but rank 0 stops them as well once its own clock says
+	so, and while pondering there is the referee to look out for, so then it waits in short turns instead.
+	*/
+	// An abandoned iteration is over once every rank has answered
+	while (!root_done && !(aborting && idle_ranks == size))
+	{
+		if (worker_node[0] != -1)
+		{
+			serving = TRUE;
+			run_job(&local_job, &result, &main_search);
+			serving = FALSE;
+			finish_job(0, &result, fp);
+		}
+		else if (pondering || main_limits.deadline > 0)
+		{
+			wait_start = monotonic_time();
+			trace_event(TRACE_IDLE_START, 0);
+			MPI_Testany(size - 1, &worker_request[1], &r, &flag, &status);
+			if (!flag && !aborting)
+			{
+				if (pondering ? comms_cmd_waiting(WAIT_POLL_MS) : (nanosleep(&pause, NULL), time_up(&main_limits)))
+					abort_iteration();
+			}
+			trace_event(TRACE_IDLE_END, 0);
+			idle_time += monotonic_time() - wait_start;
+			if (!flag)
+				continue;
+			if (r == MPI_UNDEFINED)
+				break;
+			finish_job(r + 1, &worker_result[r + 1], fp);
+		}
+		else
+		{
+			wait_start = monotonic_time();
+			trace_event(TRACE_IDLE_START, 0);
+			MPI_Waitany(size - 1, &worker_request[1], &r, &status);
+			trace_event(TRACE_IDLE_END, 0);
+			idle_time += monotonic_time() - wait_start;
+			if (r == MPI_UNDEFINED)
+				break;
+			finish_job(r + 1, &worker_result[r + 1], fp);
+		}
+	}
+
+	// The next iteration needs the workers that are still speculating
+	stop_speculation(size);
+	while (idle_ranks < size)
+	{
+		wait_start = monotonic_time();
+		trace_event(TRACE_IDLE_START, 0);
+		MPI_Waitany(size - 1, &worker_request[1], &r, &status);
+		trace_event(TRACE_IDLE_END, 0);
+		idle_time += monotonic_time() - wait_start;
+		if (r == MPI_UNDEFINED)
+			break;
+		finish_job(r + 1, &worker_result[r + 1], fp);
+	}
+
+	if (aborting)
+	{
+		return -1;
+	}
+	// The root moves may have been handed out in another order than they came in
+	for (i = 1; i <= moves[0]; i++)
+	{
+		scores[i] = -INFINITY_SCORE;
+		for (r = 1; r <= root->started; r++)
+		{
+			if (root->moves[r] == moves[i])
+				scores[i] = root->scores[r];
+		}
+	}
+	if (!pondering)
+	{
+		memcpy(move_cost, iteration_cost, sizeof(move_cost));
+	}
+	return root->best_move;
+}
+
+/**
+ * @brief Returns the window of split node n narrowed by the windows of all its ancestors. This is the window every
+ * search below n has to use.
+ *
+ * @param n
+ * @param alpha
+ * @param beta
+ */
+void node_window(int n, int *alpha, int *beta)
+{
+	*alpha = -INFINITY_SCORE;
+	*beta = INFINITY_SCORE;
+	for (; n != -1; n = split_nodes[n].parent)
+	{
+		if (split_nodes[n].alpha > *alpha)
+			*alpha = split_nodes[n].alpha;
+		if (split_nodes[n].beta < *beta)
+			*beta = split_nodes[n].beta;
+	}
+}
+
+/**
+ * @brief Returns TRUE if split node n has a child that may be started: its eldest child, or any younger brother
+ * once the eldest has finished.
+ *
+ * @param n
+ * @return int
+ */
+int child_ready(int n)
+{
+	split_node *node = &split_nodes[n];
+
+	if (!node->in_use || node->cut || node->started == node->moves[0])
+		return FALSE;
+	// Young brothers wait for the eldest
+	return node->started == 0 || node->finished > 0;
+}
+
+/**
+ * @brief Hands out work for as long as ranks are idle and some split node has a child that may be started. Workers
+ * the iteration has nothing for are given speculative jobs, and speculative jobs are stopped for as many children as
+ * are ready with no rank to take them.
+ *
+ * @param fp
+ */
+void schedule(FILE *fp)
+{
+	int n, progress, ready;
+
+	progress = TRUE;
+	while (idle_ranks > 0 && progress && !aborting)
+	{
+		progress = FALSE;
+		for (n = 0; n < MAXSPLITNODES && idle_ranks > 0; n++)
+		{
+			if (!child_ready(n))
+				continue;
+			start_child(n, fp);
+			progress = TRUE;
+		}
+	}
+	if (!opts.speculate || aborting)
+		return;
+	if (idle_ranks > 0)
+	{
+		speculate(fp);
+		return;
+	}
+	for (ready = 0, n = 0; n < MAXSPLITNODES; n++)
+	{
+		if (!child_ready(n))
+			continue;
+		ready += split_nodes[n].started == 0 ? 1 : split_nodes[n].moves[0] - split_nodes[n].started;
+	}
+	stop_speculation(ready);
+}
+
+/**
+ * @brief Hands every idle worker a speculative job once the root moves are all handed out: a likely reply of the
+ * opponent to speculation_move, searched from the board after both one ply deeper than the iteration would search
+ * it. Its score is thrown away; the point is what it leaves in the transposition table of its rank for the next
+ * gen_move, should the opponent play that reply. A worker keeps the reply it had before, so that it goes on from its
+ * own table, and the others take the likeliest replies no worker has had yet.
+ *
+ * @param fp
+ */
+void speculate(FILE *fp)
+{
+	split_node *root = &split_nodes[0];
+	search_job job;
+	position pos;
+	int replies[LEGALMOVSBUFSIZE];
+	int opp = opponent(my_colour, fp);
+	int r, s, i, reply;
+
+	if (pondering || root_done || speculation_move == -1 || root->started < root->moves[0] || time_up(&main_limits))
+		return;
+	pos = root->pos;
+	make_position_move(&pos, speculation_move, my_colour, fp);
+	replies[0] = order_moves(&pos, bb_moves(pos.discs[opp], pos.discs[my_colour]), opp, 0, 1, &replies[1],
+							 &main_search);
+
+	for (r = 1; r < size; r++)
+	{
+		if (worker_node[r] != -1 || worker_blocked[r])
+			continue;
+		reply = worker_reply[r];
+		for (i = 1; reply == -1 && i <= replies[0]; i++)
+		{
+			for (s = 1; s < size && worker_reply[s] != replies[i]; s++)
+				;
+			if (s == size)
+				reply = replies[i];
+		}
+		if (reply == -1)
+			return;
+
+		job.id = ++job_count;
+		job.depth = root->depth + 1;
+		job.alpha = -INFINITY_SCORE;
+		job.beta = INFINITY_SCORE;
+		job.length = 2;
+		job.path[0] = speculation_move;
+		job.path[1] = reply;
+		MPI_Send(&job, sizeof(search_job) / sizeof(int), MPI_INT, r, 100, MPI_COMM_WORLD);
+		MPI_Start(&worker_request[r]);
+		trace_event(TRACE_JOB_SENT, r);
+
+		worker_node[r] = SPECULATION;
+		worker_job[r] = job.id;
+		worker_reply[r] = reply;
+		idle_ranks--;
+		speculative_jobs++;
+	}
+}
+
+/**
+ * @brief Sends a stop on tag 115 to as many of the workers searching speculative jobs as it takes to have count of
+ * them stopping, counting those already stopped
+ *
+ * @param count
+ */
+void stop_speculation(int count)
+{
+	int r;
+
+	for (r = 1; r < size; r++)
+	{
+		if (worker_node[r] == SPECULATION && worker_blocked[r])
+			count--;
+	}
+	for (r = 1; r < size && count > 0; r++)
+	{
+		if (worker_node[r] != SPECULATION || worker_blocked[r])
+			continue;
+		MPI_Send(&worker_job[r], 1, MPI_INT, r, 115, MPI_COMM_WORLD);
+		worker_blocked[r] = TRUE;
+		count--;
+	}
+}
+
+/**
+ * @brief Starts the next child of split node n: as a split node of its own while it is shallow and deep enough to
+ * be worth splitting, and otherwise as a job for an idle rank.
+ *
+ * @param n
+ * @param fp
+ */
+void start_child(int n, FILE *fp)
+{
+	split_node *node = &split_nodes[n];
+	split_node *child;
+	search_job job;
+	position pos;
+	int i, c, r, move, empties, next;
+	double total;
+
+	c = ++node->started;
+	move = node->moves[c];
+	pos = node->pos;
+	make_position_move(&pos, move, node->mover, fp);
+	empties = BB_SQUARES - bb_count(pos.discs[BLACK] | pos.discs[WHITE]);
+
+	// A root move that took less than its share of the ranks last iteration is not worth splitting
+	total = 0;
+	for (i = 0; i < 100 && n == 0; i++)
+	{
+		total += move_cost[i];
+	}
+	i = -1;
+	if (node->ply + 1 < opts.split && node->depth - 1 >= MIN_SPLIT_DEPTH &&
+		!(node->depth >= empties && empties <= opts.endgame) && !(n == 0 && move_cost[move] * size < total))
+	{
+		for (i = 1; i < MAXSPLITNODES && split_nodes[i].in_use; i++)
+			;
+		if (i == MAXSPLITNODES)
+			i = -1;
+	}
+
+	if (i != -1)
+	{
+		child = &split_nodes[i];
+		memset(child, 0, sizeof(split_node));
+		child->in_use = TRUE;
+		child->parent = n;
+		child->child = c;
+		child->pos = pos;
+		child->depth = node->depth - 1;
+		child->ply = node->ply + 1;
+		node_window(n, &child->alpha, &child->beta);
+		memcpy(child->path, node->path, node->length * sizeof(int));
+		child->length = node->length;
+		child->path[child->length++] = move;
+
+		// The side to move passes if it has no moves, and the game is over if neither has
+		next = opponent(node->mover, fp);
+		if (bb_moves(pos.discs[next], pos.discs[node->mover]) != 0)
+		{
+			child->mover = next;
+		}
+		else if (bb_moves(pos.discs[node->mover], pos.discs[next]) != 0)
+		{
+			child->mover = node->mover;
+			child->path[child->length++] = PASS;
+		}
+		else
+		{
+			child->in_use = FALSE;
+			child_result(n, c, endgame_score(final_discs(pos.discs[my_colour], pos.discs[opponent(my_colour, fp)])));
+			return;
+		}
+		child->moves[0] = order_moves(&child->pos, bb_moves(pos.discs[child->mover], pos.discs[opponent(child->mover, fp)]),
+									  child->mover, 0, child->ply, &child->moves[1], &main_search);
+		child->moves[0] = drop_symmetric_moves(&child->pos, child->mover, child->moves, fp);
+		return;
+	}
+
+	// Rank 0 takes a job only when no worker is free, as it answers the workers less promptly while it searches
+	for (r = 1; r < size && worker_node[r] != -1; r++)
+		;
+	if (r == size)
+		r = 0;
+	// The worker that searched this board ahead of time has the most in its table to go on
+	if (warm_rank != -1 && worker_node[warm_rank] == -1)
+		r = warm_rank;
+	job.id = ++job_count;
+	job.depth = node->depth;
+	node_window(n, &job.alpha, &job.beta);
+	memcpy(job.path, node->path, node->length * sizeof(int));
+	job.length = node->length;
+	job.path[job.length++] = move;
+	if (r == 0)
+	{
+		local_job = job;
+	}
+	else
+	{
+		MPI_Send(&job, sizeof(search_job) / sizeof(int), MPI_INT, r, 100, MPI_COMM_WORLD);
+		MPI_Start(&worker_request[r]);
+		trace_event(TRACE_JOB_SENT, r);
+	}
+
+	worker_node[r] = n;
+	worker_child[r] = c;
+	worker_job[r] = job.id;
+	worker_start[r] = monotonic_time();
+	worker_alpha[r] = job.alpha;
+	worker_beta[r] = job.beta;
+	idle_ranks--;
+}
+
+/**
+ * @brief Takes in the result of child c of split node n. Once the node has no more children to wait for, its own
+ * result is passed up to its parent; the root finishing ends the iteration.
+ *
+ * @param n
+ * @param c
+ * @param value
+ */
+void child_result(int n, int c, int value)
+{
+	split_node *node = &split_nodes[n];
+	int alpha, beta, changed;
+
+	node->finished++;
+	node->scores[c] = value;
+	changed = FALSE;
+	if (!node->cut)
+	{
+		if (node->mover == my_colour && value > node->alpha)
+		{
+			node->alpha = value;
+			node->best_move = node->moves[c];
+			changed = TRUE;
+		}
+		else if (node->mover != my_colour && value < node->beta)
+		{
+			node->beta = value;
+			node->best_move = node->moves[c];
+			changed = TRUE;
+		}
+		node_window(n, &alpha, &beta);
+		if (alpha >= beta)
+		{
+			node->cut = TRUE;
+		}
+	}
+	if ((node->cut || node->started == node->moves[0]) && node->finished == node->started)
+	{
+		node->in_use = FALSE;
+		value = (node->mover == my_colour) ? node->alpha : node->beta;
+		if (node->parent == -1)
+		{
+			root_done = TRUE;
+		}
+		else
+		{
+			child_result(node->parent, node->child, value);
+		}
+	}
+	else if (changed)
+	{
+		send_bounds();
+	}
+}
+
+/**
+ * @brief Sends every rank whose job lies below a split node with a tighter window than it was given that window
+ *
+ */
+void send_bounds()
+{
+	bound_update update;
+	int r;
+
+	for (r = 0; r < size; r++)
+	{
+		if (worker_node[r] == -1 || worker_node[r] == SPECULATION)
+			continue;
+		node_window(worker_node[r], &update.alpha, &update.beta);
+		if (update.alpha > worker_alpha[r] || update.beta < worker_beta[r])
+		{
+			update.id = worker_job[r];
+			if (r == 0)
+			{
+				// The job rank 0 is searching itself, which is below this call on the stack
+				if (update.alpha > main_limits.alpha)
+					main_limits.alpha = update.alpha;
+				if (update.beta < main_limits.beta)
+					main_limits.beta = update.beta;
+			}
+			else
+			{
+				MPI_Send(&update, 3, MPI_INT, r, 110, MPI_COMM_WORLD);
+			}
+			worker_alpha[r] = update.alpha;
+			worker_beta[r] = update.beta;
+		}
+	}
+}
+
+/**
+ * @brief Takes in the result of the job rank r was searching and hands out whatever work is ready now
+ *
+ * @param r
+ * @param result
+ * @param fp
+ */
+void finish_job(int r, job_result *result, FILE *fp)
+{
+	int n = worker_node[r];
+	int c = worker_child[r];
+
+	assert(result->id == worker_job[r]);
+	if (r != 0)
+		trace_event(TRACE_RESULT_RECEIVED, r);
+	if (n == SPECULATION)
+	{
+		// A worker stopped to make room may speculate again, one that finished or ran into the deadline may not
+		worker_blocked[r] = !(worker_blocked[r] && result->status == JOB_ABORTED);
+		worker_node[r] = -1;
+		idle_ranks++;
+		schedule(fp);
+		return;
+	}
+	// The time of the job goes to the root move it is below
+	for (; split_nodes[n].parent != -1; n = split_nodes[n].parent)
+		c = split_nodes[n].child;
+	iteration_cost[split_nodes[0].moves[c]] += monotonic_time() - worker_start[r];
+	n = worker_node[r];
+	worker_node[r] = -1;
+	idle_ranks++;
+	// A rank that ran into the deadline has no score, after which the iteration is abandoned
+	if (result->status == JOB_ABORTED && !aborting)
+	{
+		abort_iteration();
+	}
+	child_result(n, worker_child[r], result->score);
+	schedule(fp);
+}
+
+/**
+ * @brief Called by rank 0 from inside the search of its own job: takes in every result that has come in from the
+ * workers since it last looked, and while pondering gives up on the search once the referee has sent a command
+ */
+void serve_workers()
+{
+	MPI_Status status;
+	int r, flag;
+
+	if (pondering && !aborting && comms_cmd_waiting(0))
+	{
+		abort_iteration();
+	}
+
+	while (TRUE)
+	{
+		MPI_Testany(size - 1, &worker_request[1], &r, &flag, &status);
+		if (!flag || r == MPI_UNDEFINED)
+			break;
+		finish_job(r + 1, &worker_result[r + 1], fp);
+	}
+}
+
+/**
+ * @brief Gives up on the current iteration: no more work is handed out and every rank still searching is sent a
+ * stop for its job on tag 115, so that it unwinds as soon as it sees it. What the iteration has found so far is
+ * kept in partial_move.
+ *
+ */
+void abort_iteration()
+{
+	int r;
+
+	aborting = TRUE;
+	partial_move = split_nodes[0].finished > 0 ? split_nodes[0].best_move : -1;
+	split_nodes[0].cut = TRUE;
+	split_nodes[0].alpha = INFINITY_SCORE;
+	split_nodes[0].beta = -INFINITY_SCORE;
+	for (r = 0; r < size; r++)
+	{
+		if (worker_node[r] == -1)
+			continue;
+		if (r == 0)
+			main_limits.stopped = TRUE;
+		else
+			MPI_Send(&worker_job[r], 1, MPI_INT, r, 115, MPI_COMM_WORLD);
+		worker_blocked[r] = TRUE;
+	}
+}
+
+/**
+ * @brief A serial function that runs the minimax algorithm to the given depth when the threads specified are equal
+ * to one. Returns -1 if the deadline cut the iteration short, leaving the best of the moves it finished in
+ * partial_move. The score of moves[i] is left in scores[i], as in split_search. Each move is searched with the best
+ * score so far as its lower bound.
+ *
+ * @param moves
+ * @param scores
+ * @param depth
+ * @param alpha
+ * @param beta
+ * @return int
+ */
+int serial(int *moves, int *scores, int depth, int alpha, int beta)
+{
+
+	int result, best_move;
+
+	best_move = moves[1];
+	partial_move = -1;
+
+	for (int i = 1; i <= moves[0]; i++)
+	{
+		scores[i] = -INFINITY_SCORE;
+	}
+	for (int i = 1; i <= moves[0] && alpha < beta; i++)
+	{
+
+		result = minimax(moves[i], my_colour, depth, alpha, beta, board, &main_search);
+		if (result == ABORTED_SCORE)
+		{
+			if (i > 1)
+				partial_move = best_move;
+			return -1;
+		}
+		scores[i] = result;
+
+		if (result > alpha)
+		{
+			best_move = moves[i];
+			alpha = result;
+		}
+	}
+
+	return best_move;
+}
+
+void apply_opp_move(char *move, int my_colour, FILE *fp)
+{
+	int loc, r;
+	warm_rank = -1;
+	if (strcmp(move, "pass\n") == 0)
+	{
+		speculation_move = -1;
+		return;
+	}
+	loc = get_loc(move);
+	// The worker that searched this reply ahead of time is handed the first jobs of the next gen_move
+	for (r = 1; r < size && speculation_move != -1; r++)
+	{
+		if (worker_reply[r] == loc)
+			warm_rank = r;
+	}
+	speculation_move = -1;
+	make_move(loc, opponent(my_colour, fp), fp);
+}
+
+void game_over()
+{
+	int r;
+
+	for (r = 1; r < size; r++)
+	{
+		MPI_Request_free(&worker_request[r]);
+	}
+	stop_helpers(&main_pool);
+	tt_free();
+	tt_unshare();
+	pattern_free();
+	book_close();
+	trace_close();
+	free_board();
+	MPI_Type_free(&board_type);
+	MPI_Finalize();
+}
+
+void get_move_string(int loc, char *ms)
+{
 	int row, col, new_loc;
 	new_loc = loc - (9 + 2 * (loc / 10));
 	row = new_loc / 8;
@@ -578,498 +2533,1395 @@ void get_move_string(int loc, char *ms)
 	ms[3] = 0;
 }
 
-int get_loc(char *movestring)
+int get_loc(char *movestring)
+{
+	int row, col;
+	/* movestring of form "xy", x = row and y = column */
+	row = movestring[0] - '0';
+	col = movestring[1] - '0';
+	return (10 * (row + 1)) + col + 1;
+}
+
+/**
+ * Fills moves[1..moves[0]] with the legal moves of player, in square order.
+ * The moves are generated on bitboards taken from the current board.
+ */
+void legal_moves(int player, int *moves, FILE *fp)
+{
+	uint64_t own, opp, legal;
+	int i;
+	get_bitboards(board, player, &own, &opp, fp);
+	legal = bb_moves(own, opp);
+	i = 0;
+	while (legal)
+	{
+		i++;
+		moves[i] = bb_to_square(bb_first(legal));
+		legal &= legal - 1;
+	}
+	moves[0] = i;
+}
+
+int legalp(int move, int player, FILE *fp)
+{
+	uint64_t own, opp;
+	if (!validp(move))
+		return 0;
+	get_bitboards(board, player, &own, &opp, fp);
+	if (bb_moves(own, opp) & BB_BIT(bb_from_square(move)))
+		return 1;
+	else
+		return 0;
+}
+int validp(int move)
+{
+	if ((move >= 11) && (move <= 88) && (move % 10 >= 1) && (move % 10 <= 8))
+		return 1;
+	else
+		return 0;
+}
+
+int opponent(int player, FILE *fp)
+{
+	if (player == BLACK)
+		return WHITE;
+	if (player == WHITE)
+		return BLACK;
+	fprintf(fp, "illegal player\n");
+	return EMPTY;
+}
+
+/**
+ * Splits a mailbox board into the bitboards of player and its opponent
+ */
+void get_bitboards(int *board, int player, uint64_t *own, uint64_t *opp, FILE *fp)
+{
+	int bit, piece;
+	int opp_colour = opponent(player, fp);
+	*own = 0;
+	*opp = 0;
+	for (bit = 0; bit < BB_SQUARES; bit++)
+	{
+		piece = board[bb_to_square(bit)];
+		if (piece == player)
+			*own |= BB_BIT(bit);
+		else if (piece == opp_colour)
+			*opp |= BB_BIT(bit);
+	}
+}
+
+/**
+ * Loads a mailbox board into a search position
+ */
+void load_position(int *board, position *pos, FILE *fp)
+{
+	int colour;
+
+	get_bitboards(board, BLACK, &pos->discs[BLACK], &pos->discs[WHITE], fp);
+	pos->discs[EMPTY] = 0;
+	pos->key = zobrist_key(pos->discs);
+	for (colour = EMPTY; colour <= WHITE; colour++)
+		pos->weight[colour] = square_weights(pos->discs[colour]);
+}
+
+/**
+ * Plays a legal move for player on a search position, updating the Zobrist key for the new disc and each flip
+ */
+void make_position_move(position *pos, int move, int player, FILE *fp)
+{
+	int bit = bb_from_square(move);
+	int opp = opponent(player, fp);
+	uint64_t flips = bb_flips(bit, pos->discs[player], pos->discs[opp]);
+	uint64_t f;
+	int flipped = 0;
+	pos->discs[player] |= flips | BB_BIT(bit);
+	pos->discs[opp] ^= flips;
+	pos->key ^= zobrist[player][bit];
+	for (f = flips; f; f &= f - 1)
+	{
+		pos->key ^= zobrist[player][bb_first(f)] ^ zobrist[opp][bb_first(f)];
+		flipped += weights[bb_to_square(bb_first(f))];
+	}
+	pos->weight[player] += weights[move] + flipped;
+	pos->weight[opp] -= flipped;
+}
+
+int random_strategy(int my_colour, FILE *fp)
+{
+	int r;
+	int moves[LEGALMOVSBUFSIZE];
+
+	legal_moves(my_colour, moves, fp);
+	if (moves[0] == 0)
+	{
+		return -1;
+	}
+	srand(time(NULL));
+	r = moves[(rand() % moves[0]) + 1];
+	return (r);
+}
+
+void make_move(int move, int player, FILE *fp)
+{
+	uint64_t own, opp, flips;
+	// Rank 0 keeps the moves it makes for the next board it broadcasts
+	if (rank == 0 && opts.sync > 0 && sync_count++ < MAXSYNCMOVES)
+	{
+		sync_moves[sync_count - 1] = 0x80 | (player == WHITE ? 0x40 : 0) | bb_from_square(move);
+	}
+	get_bitboards(board, player, &own, &opp, fp);
+	flips = bb_flips(bb_from_square(move), own, opp);
+	board[move] = player;
+	while (flips)
+	{
+		board[bb_to_square(bb_first(flips))] = player;
+		flips &= flips - 1;
+	}
+}
+
+void print_board(FILE *fp)
+{
+	int row, col;
+	position pos;
+	load_position(board, &pos, fp);
+	fprintf(fp, "   1 2 3 4 5 6 7 8 [%c=%d %c=%d]\n",
+			nameof(BLACK), heuristic_score(BLACK, &pos), nameof(WHITE), heuristic_score(WHITE, &pos));
+	for (row = 1; row <= 8; row++)
+	{
+		fprintf(fp, "%d  ", row);
+		for (col = 1; col <= 8; col++)
+			fprintf(fp, "%c ", nameof(board[col + (10 * row)]));
+		fprintf(fp, "\n");
+	}
+	fflush(fp);
+}
+
+char nameof(int piece)
+{
+	assert(0 <= piece && piece < 5);
+	return (piecenames[piece]);
+}
+
+int count(int player, int *board)
 {
-	int row, col;
-	/* movestring of form "xy", x = row and y = column */
-	row = movestring[0] - '0';
-	col = movestring[1] - '0';
-	return (10 * (row + 1)) + col + 1;
+	uint64_t own, opp;
+	get_bitboards(board, player, &own, &opp, fp);
+	return bb_count(own);
 }
 
-void legal_moves(int player, int *moves, FILE *fp)
+/**
+ * @brief A function to iteratively run through the moves available and increase the depth based on the amount.
+ * Used to increase the speed of the program. Only used as a fixed depth when no time limit is given.
+ *
+ * @param moves
+ * @return int
+ */
+int dynamic_depth(int moves)
 {
-	int move, i;
-	moves[0] = 0;
-	i = 0;
-	for (move = 11; move <= 88; move++)
-		if (legalp(move, player, fp))
+	if (moves >= 3 && moves < 8)
+	{
+		return 6;
+	}
+
+	else if (moves >= 8 && moves < 15)
+	{
+		return 5;
+	}
+
+	else if (moves >= 15)
+	{
+		return 4;
+	}
+
+	else if (size == 1)
+	{
+		return 0;
+	}
+
+	else
+	{
+		return 7;
+	}
+
+	return 2;
+}
+/**
+ * @brief The minimax starter function, searches move to the given depth.
+ * Loads sent_board into the root of the search stack and computes the result from the alpha beta function with the
+ * window alpha, beta. Returns ABORTED_SCORE if the deadline passed before the search finished.
+ *
+ * @param move
+ * @param colour
+ * @param depth
+ * @param alpha
+ * @param beta
+ * @param sent_board
+ * @param ctx
+ * @return int
+ */
+int minimax(int move, int colour, int depth, int alpha, int beta, int *sent_board, search_context *ctx)
+{
+	int result;
+
+	ctx->limits->alpha = -INFINITY_SCORE;
+	ctx->limits->beta = INFINITY_SCORE;
+	ctx->limits->stopped = FALSE;
+	ctx->side = my_colour;
+	ctx->root_ply = 0;
+	load_position(sent_board, &ctx->stack[0], ctx->log);
+	result = smp_search(move, alpha, beta, colour, depth, ctx);
+
+	if (ctx->aborted)
+	{
+		return ABORTED_SCORE;
+	}
+	return result;
+}
+
+/**
+ * @brief Searches a job handed out by split_search: replays its path from the board of the gen_move and searches
+ * the last move of it with the job's window, leaving the answer to send back in result.
+ *
+ * @param job
+ * @param result
+ * @param ctx
+ */
+void run_job(search_job *job, job_result *result, search_context *ctx)
+{
+	int side = root_mover;
+	int i;
+
+	trace_event(TRACE_JOB_START, job->id);
+	current_job = job->id;
+	ctx->limits->alpha = job->alpha;
+	ctx->limits->beta = job->beta;
+	ctx->limits->stopped = FALSE;
+	ctx->aborted = time_up(ctx->limits);
+	ctx->side = my_colour;
+	ctx->root_ply = job->length - 1;
+	load_position(board, &ctx->stack[0], ctx->log);
+	for (i = 0; i < job->length - 1; i++)
+	{
+		if (job->path[i] != PASS)
+		{
+			make_position_move(&ctx->stack[0], job->path[i], side, ctx->log);
+		}
+		side = opponent(side, ctx->log);
+	}
+	result->id = job->id;
+	result->move = job->path[job->length - 1];
+	result->score = smp_search(result->move, job->alpha, job->beta, side, job->depth, ctx);
+	result->status = JOB_DONE;
+	if (ctx->aborted)
+	{
+		// Once rank 0 has closed the window the score is not looked at, only a deadline or a stop aborts the iteration
+		result->status =
+			ctx->limits->alpha >= ctx->limits->beta && !ctx->limits->stopped ? JOB_CLOSED : JOB_ABORTED;
+	}
+	trace_event(TRACE_JOB_END, result->status);
+}
+
+/**
+ * @brief Takes in what rank 0 has sent about the jobs since: bound updates on tag 110, tightening the window of the
+ * current job in limits with those meant for it, and stops on tag 115, the id of a job to give up on. Nothing else
+ * can come while a job is being searched, as rank 0 sends the next job only once this one is answered.
+ *
+ * @param limits
+ */
+void poll_messages(search_limits *limits)
+{
+	MPI_Status status;
+	bound_update update;
+	int flag, stop;
+
+	MPI_Iprobe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+	while (flag)
+	{
+		if (status.MPI_TAG == 115)
+		{
+			MPI_Recv(&stop, 1, MPI_INT, 0, 115, MPI_COMM_WORLD, &status);
+			if (stop == current_job)
+				limits->stopped = TRUE;
+		}
+		else
+		{
+			MPI_Recv(&update, 3, MPI_INT, 0, 110, MPI_COMM_WORLD, &status);
+			if (update.id == current_job)
+			{
+				if (update.alpha > limits->alpha)
+					limits->alpha = update.alpha;
+				if (update.beta < limits->beta)
+					limits->beta = update.beta;
+			}
+		}
+		MPI_Iprobe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+	}
+}
+
+/**
+ * @brief Counts a node and every CLOCK_CHECK_NODES nodes looks at the clock and, on the main thread, for new
+ * bounds and stops on a worker or for results from the workers at rank 0. Returns TRUE once the search has to be
+ * given up: at the deadline, once rank 0 has stopped the job or closed its window, and for a helper thread once the
+ * main thread has finished.
+ *
+ * @return int
+ */
+int search_interrupted(search_context *ctx)
+{
+	if (ctx->aborted)
+		return TRUE;
+	if (ctx->helper && ctx->limits->helpers_stop)
+	{
+		ctx->aborted = TRUE;
+		return TRUE;
+	}
+	if (++ctx->stats.nodes % CLOCK_CHECK_NODES == 0)
+	{
+		if (rank != 0 && !ctx->helper)
+		{
+			poll_messages(ctx->limits);
+		}
+		else if (serving && !ctx->helper)
+		{
+			serve_workers();
+		}
+		if (time_up(ctx->limits) || ctx->limits->stopped || ctx->limits->alpha >= ctx->limits->beta)
+		{
+			ctx->aborted = TRUE;
+		}
+	}
+	return ctx->aborted;
+}
+
+/**
+ * @brief Starts the helper threads of pool, opts.threads - 1 of them. Threads are not used if MPI cannot run
+ * alongside them.
+ *
+ * @param pool
+ */
+void start_helpers(helper_pool *pool)
+{
+	int provided, i;
+
+	MPI_Query_thread(&provided);
+	if (opts.threads > 1 && provided < MPI_THREAD_FUNNELED)
+	{
+		fprintf(stderr, "Rank %d searches single threaded, MPI does not support threads\n", rank);
+		opts.threads = 1;
+	}
+	for (i = 1; i < opts.threads; i++)
+	{
+		if (pthread_create(&pool->threads[i], NULL, helper_thread, pool) != 0)
+		{
+			fprintf(stderr, "Rank %d could only start %d search threads\n", rank, i);
+			break;
+		}
+	}
+	pool->started = i - 1;
+}
+
+void stop_helpers(helper_pool *pool)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->task.quit = TRUE;
+	pool->tasks++;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	for (i = 1; i <= pool->started; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+	pool->started = 0;
+	pool->joined = 0;
+}
+
+/**
+ * @brief Waits for smp_search to hand out a search to pool and searches it, until stop_helpers. Odd numbered threads
+ * search one ply deeper than the main thread, so that the threads spread over more of the tree and leave deeper
+ * results in the transposition table for each other. Their own results are thrown away.
+ *
+ * @param arg the helper_pool of the thread
+ * @return void*
+ */
+void *helper_thread(void *arg)
+{
+	helper_pool *pool = (helper_pool *)arg;
+	int id, tasks = 0, search = 0;
+	smp_task task;
+	search_context context;
+	search_context *ctx = &context;
+
+	memset(ctx, 0, sizeof(search_context));
+	ctx->helper = TRUE;
+	pthread_mutex_lock(&pool->mutex);
+	id = ++pool->joined;
+	while (TRUE)
+	{
+		while (pool->tasks == tasks)
+		{
+			pthread_cond_wait(&pool->wake, &pool->mutex);
+		}
+		tasks = pool->tasks;
+		task = pool->task;
+		if (task.quit)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&pool->mutex);
+
+		if (task.search != search)
+		{
+			search = task.search;
+			age_history(ctx);
+			ctx->max_ply = 0;
+		}
+		ctx->aborted = FALSE;
+		ctx->limits = task.limits;
+		ctx->stack[0] = task.root;
+		ctx->side = task.side;
+		ctx->root_ply = task.ply;
+		alpha_beta(task.move, task.alpha, task.beta, task.colour, task.depth + (id & 1), 0, ctx);
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->stats.nodes += ctx->stats.nodes;
+		pool->stats.evals += ctx->stats.evals;
+		pool->stats.cutoffs += ctx->stats.cutoffs;
+		pool->stats.first_cutoffs += ctx->stats.first_cutoffs;
+		pool->stats.tt_probes += ctx->stats.tt_probes;
+		pool->stats.tt_hits += ctx->stats.tt_hits;
+		pool->stats.probcuts += ctx->stats.probcuts;
+		memset(&ctx->stats, 0, sizeof(search_stats));
+		if (ctx->max_ply > pool->max_ply)
+			pool->max_ply = ctx->max_ply;
+		if (--pool->running == 0)
+		{
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+/**
+ * @brief Searches move for colour from ctx->stack[0] like alpha_beta at ply 0, with the helper threads of ctx
+ * searching the same position within the same limits at the same time. Returns once the main thread has its result
+ * and the helpers have stopped.
+ *
+ * @param move
+ * @param alpha
+ * @param beta
+ * @param colour
+ * @param depth
+ * @param ctx
+ * @return int
+ */
+int smp_search(int move, int alpha, int beta, int colour, int depth, search_context *ctx)
+{
+	helper_pool *pool = ctx->pool;
+	int result;
+
+	if (pool == NULL || pool->started == 0)
+	{
+		return alpha_beta(move, alpha, beta, colour, depth, 0, ctx);
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->task.root = ctx->stack[0];
+	pool->task.move = move;
+	pool->task.alpha = alpha;
+	pool->task.beta = beta;
+	pool->task.colour = colour;
+	pool->task.side = ctx->side;
+	pool->task.depth = depth;
+	pool->task.ply = ctx->root_ply;
+	pool->task.search = search_number;
+	pool->task.limits = ctx->limits;
+	ctx->limits->helpers_stop = FALSE;
+	pool->running = pool->started;
+	pool->tasks++;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+
+	result = alpha_beta(move, alpha, beta, colour, depth, 0, ctx);
+
+	ctx->limits->helpers_stop = TRUE;
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->running > 0)
+	{
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return result;
+}
+
+void reset_stats()
+{
+	memset(&main_search.stats, 0, sizeof(search_stats));
+	memset(&main_pool.stats, 0, sizeof(search_stats));
+	main_search.max_ply = 0;
+	main_pool.max_ply = 0;
+	idle_time = 0;
+	speculative_jobs = 0;
+}
+
+/**
+ * @brief Called by every rank at the end of a gen_move. Sums the counts of all threads and ranks into total, takes
+ * the deepest ply into deepest and collects the idle time of each rank into idle, all at rank 0. The other ranks
+ * pass NULL.
+ *
+ * @param total
+ * @param deepest
+ * @param idle
+ */
+void gather_stats(search_stats *total, int *deepest, double *idle)
+{
+	search_stats own = main_search.stats;
+	int ply = main_search.max_ply;
+
+	own.nodes += main_pool.stats.nodes;
+	own.evals += main_pool.stats.evals;
+	own.cutoffs += main_pool.stats.cutoffs;
+	own.first_cutoffs += main_pool.stats.first_cutoffs;
+	own.tt_probes += main_pool.stats.tt_probes;
+	own.tt_hits += main_pool.stats.tt_hits;
+	own.probcuts += main_pool.stats.probcuts;
+	if (main_pool.max_ply > ply)
+		ply = main_pool.max_ply;
+
+	MPI_Reduce(&own, total, sizeof(search_stats) / sizeof(long), MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&ply, deepest, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Gather(&idle_time, 1, MPI_DOUBLE, idle, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+}
+
+/**
+ * @brief Writes one JSON line on the search of the move just made to fp, after collecting the counts of all ranks.
+ * depth is the last iteration that finished and elapsed the seconds the move took. A ponder search is written
+ * under "ponder" with the number of the move it followed. makespan is how long the last finished iteration took and
+ * idle_fraction the share of the time of all ranks they spent waiting, with opts.speculate followed by
+ * speculative_jobs, with opts.shared by the probes and hits of the distributed table and with ProbCut by the nodes it
+ * cut. In a benchmark each line is numbered by
+ * "position" instead and also says how many ranks searched, the move played and whether it is the one expected.
+ *
+ * @param depth
+ * @param move
+ * @param elapsed
+ * @param fp
+ */
+void report_stats(int depth, char *move, double elapsed, FILE *fp)
+{
+	search_stats total;
+	double *idle = (double *)malloc(size * sizeof(double));
+	double total_idle;
+	int deepest, r;
+
+	gather_stats(&total, &deepest, idle);
+
+	fprintf(fp, "{\"%s\": %d, ", pondering ? "ponder" : benchmark ? "position" : "move",
+			benchmark ? bench_position : move_number);
+	if (benchmark)
+		fprintf(fp, "\"ranks\": %d, ", size);
+	fprintf(fp, "\"time\": %.3f, \"depth\": %d, \"max_ply\": %d, \"nodes\": %ld, \"nps\": %.0f, "
+				"\"evals\": %ld, \"cutoffs\": %ld, \"first_cutoff_rate\": %.3f, \"tt_probes\": %ld, \"tt_hits\": %ld, "
+				"\"idle\": [",
+			elapsed, depth, deepest, total.nodes, elapsed > 0 ? total.nodes / elapsed : 0.0, total.evals,
+			total.cutoffs, total.cutoffs > 0 ? (double)total.first_cutoffs / total.cutoffs : 0.0, total.tt_probes,
+			total.tt_hits);
+	for (r = 0; r < size; r++)
+	{
+		fprintf(fp, r == 0 ? "%.3f" : ", %.3f", idle[r]);
+	}
+	for (total_idle = 0, r = 0; r < size; r++)
+		total_idle += idle[r];
+	fprintf(fp, "], \"makespan\": %.3f, \"idle_fraction\": %.3f", makespan,
+			elapsed > 0 ? total_idle / (size * elapsed) : 0.0);
+	if (opts.speculate)
+		fprintf(fp, ", \"speculative_jobs\": %d", speculative_jobs);
+	if (opts.shared > 0)
+		fprintf(fp, ", \"shared_probes\": %ld, \"shared_hits\": %ld", total.shared_probes, total.shared_hits);
+	if (use_probcut)
+		fprintf(fp, ", \"probcuts\": %ld", total.probcuts);
+	if (benchmark && move != NULL)
+	{
+		fprintf(fp, ", \"best\": \"%.*s\"", (int)strcspn(move, "\n"), move);
+		if (bench_expected[0] != '\0')
+			fprintf(fp, ", \"expected\": \"%.*s\", \"agree\": %s", (int)strcspn(bench_expected, "\n"),
+					bench_expected, strcmp(move, bench_expected) == 0 ? "true" : "false");
+	}
+	fprintf(fp, "}\n");
+	fflush(fp);
+	free(idle);
+}
+
+/**
+ * @brief Plays move_made for colour on a copy of ctx->stack[ply] and searches the replies of the opponent.
+ * Every ply works on its own slot of ctx->stack, so the search never touches the global board and
+ * never allocates. The opponent's replies minimise the score and our replies maximise it.
+ * Results are kept in the transposition table as bounds relative to the window they were searched with.
+ *
+ * @param move_made
+ * @param alpha
+ * @param beta
+ * @param colour
+ * @param depth
+ * @param ply
+ * @param ctx
+ * @return int
+ */
+int alpha_beta(int move_made, int alpha, int beta, int colour, int depth, int ply, search_context *ctx)
+{
+	position *pos = &ctx->stack[ply + 1];
+	int next = opponent(colour, ctx->log);
+	int mover = next;
+	uint64_t moves, key;
+	int result, move, best_move, tt_move, i, n, empties, exact, found, symmetry;
+	int alpha_orig = alpha, beta_orig = beta;
+	int list[LEGALMOVSBUFSIZE];
+	uint64_t canonical[3];
+	tt_entry entry, remote;
+
+	// Gives up once the deadline has passed, the caller throws the result away
+	if (search_interrupted(ctx))
+	{
+		return 0;
+	}
+	// Rank 0 may have narrowed the window of the job since it was handed out
+	if (!ctx->probing)
+	{
+		if (alpha < ctx->limits->alpha)
+			alpha = ctx->limits->alpha;
+		if (beta > ctx->limits->beta)
+			beta = ctx->limits->beta;
+	}
+
+	// Makes the move on a copy of the parent position
+	*pos = ctx->stack[ply];
+	make_position_move(pos, move_made, colour, ctx->log);
+
+	// Searches deep enough to reach the end of the game are finished by the exact solver
+	empties = BB_SQUARES - bb_count(pos->discs[BLACK] | pos->discs[WHITE]);
+	exact = depth >= empties && empties <= opts.endgame && game_stage(pos) == 3;
+
+	if (ply + 1 + ctx->root_ply > ctx->max_ply)
+	{
+		ctx->max_ply = ply + 1 + ctx->root_ply;
+	}
+	if (depth == 0 && !exact)
+	{
+		ctx->stats.evals++;
+		if (use_patterns)
+			return pattern_score(ctx->side, pos);
+		return heuristic_score(ctx->side, pos);
+	}
+	// Reuses an earlier search of this position if it was deep enough to settle the window. The scores are from the
+	// side of the search, which a benchmark may change between searches, so the two sides have their own keys.
+	key = pos->key;
+	symmetry = 0;
+	if (BB_SQUARES - empties <= opts.canonical)
+	{
+		// Mirror images share the entry of the board the way round bb_canonical turns it, moves included
+		canonical[EMPTY] = 0;
+		canonical[BLACK] = pos->discs[BLACK];
+		canonical[WHITE] = pos->discs[WHITE];
+		symmetry = bb_canonical(&canonical[BLACK], &canonical[WHITE]);
+		key = zobrist_key(canonical);
+	}
+	key ^= zobrist_side[next] ^ (ctx->side == WHITE ? zobrist_side[EMPTY] : 0);
+	tt_move = 0;
+	ctx->stats.tt_probes++;
+	found = tt_probe(key, &entry);
+	// Deep enough, the distributed table is looked at when the local one cannot settle the node, and caches its entry
+	if ((!found || entry.depth < depth) && opts.shared > 0 && depth >= opts.shared && !ctx->helper)
+	{
+		ctx->stats.shared_probes++;
+		if (tt_shared_probe(key, &remote) && (!found || remote.depth > entry.depth))
+		{
+			ctx->stats.shared_hits++;
+			entry = remote;
+			found = TRUE;
+			tt_store(key, entry.depth, entry.bound, entry.score, entry.move);
+		}
+	}
+	if (found)
+	{
+		ctx->stats.tt_hits++;
+		tt_move = map_square(entry.move, symmetry, TRUE);
+		if (entry.depth >= depth)
+		{
+			if (entry.bound == TT_EXACT)
+				return entry.score;
+			if (entry.bound == TT_LOWER && entry.score >= beta)
+				return entry.score;
+			if (entry.bound == TT_UPPER && entry.score <= alpha)
+				return entry.score;
+		}
+	}
+	if (exact)
+	{
+		result = endgame_search(pos, next, alpha, beta, ctx);
+		store_result(key, depth, result, alpha, beta, 0, ctx);
+		return result;
+	}
+	// Gets the opponent legal moves
+	moves = bb_moves(pos->discs[next], pos->discs[colour]);
+	// Checking if there no moves: the opponent passes, or the game is over if neither side can move
+	if (moves == 0)
+	{
+		moves = bb_moves(pos->discs[colour], pos->discs[next]);
+		if (moves == 0)
+		{
+			return endgame_score(final_discs(pos->discs[ctx->side], pos->discs[opponent(ctx->side, ctx->log)]));
+		}
+		mover = colour;
+	}
+	if (use_probcut && beta - alpha == 1 && depth < MAXPLY && probcut[game_stage(pos)][depth].shallow > 0 &&
+		probcut_cut(move_made, alpha, beta, colour, depth, ply, mover, &result, ctx))
+	{
+		ctx->stats.probcuts++;
+		return result;
+	}
+	if (opts.ordering)
+	{
+		n = order_moves(pos, moves, mover, tt_move, ply + 1, list, ctx);
+	}
+	else
+	{
+		for (n = 0; moves; moves &= moves - 1)
+			list[n++] = bb_to_square(bb_first(moves));
+	}
+	// Loop through the opponents set of moves and run the alpha beta
+	best_move = 0;
+	for (i = 0; i < n; i++)
+	{
+		move = list[i];
+		if (!ctx->probing)
+		{
+			if (alpha < ctx->limits->alpha)
+				alpha = ctx->limits->alpha;
+			if (beta > ctx->limits->beta)
+				beta = ctx->limits->beta;
+		}
+		if (alpha >= beta)
+		{
+			break;
+		}
+		// After the first move the others are only tried against the best so far, and searched again if one beats it
+		if (i > 0 && opts.pvs && beta - alpha > 1)
+		{
+			if (mover == ctx->side)
+			{
+				result = alpha_beta(move, alpha, alpha + 1, mover, depth - 1, ply + 1, ctx);
+				if (result > alpha && result < beta)
+					result = alpha_beta(move, alpha, beta, mover, depth - 1, ply + 1, ctx);
+			}
+			else
+			{
+				result = alpha_beta(move, beta - 1, beta, mover, depth - 1, ply + 1, ctx);
+				if (result < beta && result > alpha)
+					result = alpha_beta(move, alpha, beta, mover, depth - 1, ply + 1, ctx);
+			}
+		}
+		else
+		{
+			result = alpha_beta(move, alpha, beta, mover, depth - 1, ply + 1, ctx);
+		}
+
+		if (mover == ctx->side)
+		{
+			if (result > alpha)
+			{
+				alpha = result;
+				best_move = move;
+			}
+		}
+		else
+		{
+			if (result < beta)
+			{
+				beta = result;
+				best_move = move;
+			}
+		}
+		// Prune
+		if (alpha >= beta)
 		{
-			i++;
-			moves[i] = move;
+			ctx->stats.cutoffs++;
+			if (i == 0)
+				ctx->stats.first_cutoffs++;
+			// Remembers the move that caused the cutoff for the ordering of later nodes
+			ctx->history[mover][move] += depth * depth;
+			if (ctx->history[mover][move] > HISTORY_LIMIT)
+			{
+				age_history(ctx);
+			}
+			if (ctx->killers[ply + 1][0] != move)
+			{
+				ctx->killers[ply + 1][1] = ctx->killers[ply + 1][0];
+				ctx->killers[ply + 1][0] = move;
+			}
+			break;
 		}
-	moves[0] = i;
-}
+	}
 
-int legalp(int move, int player, FILE *fp)
-{
-	int i;
-	if (!validp(move))
-		return 0;
-	if (board[move] == EMPTY)
+	result = (mover == ctx->side) ? alpha : beta;
+	// Bounds are only known relative to the narrowest window any part of this node was searched with
+	if (!ctx->probing)
 	{
-		i = 0;
-		while (i <= 7 && !would_flip(move, ALLDIRECTIONS[i], player, fp))
-			i++;
-		if (i == 8)
-			return 0;
-		else
-			return 1;
+		if (alpha_orig < ctx->limits->alpha)
+			alpha_orig = ctx->limits->alpha;
+		if (beta_orig > ctx->limits->beta)
+			beta_orig = ctx->limits->beta;
 	}
-	else
-		return 0;
-}
-/*
-A function adapted from the blog: Blog: https://kartikkukreja.wordpress.com/2013/03/30/heuristic-function-for-reversiothello/
-Used to get the number of moves the opponent or player can play in the evaluation function.
-*/
-int num_valid_moves(int player, int *board, FILE *fp)
-{
-	int i, move;
-	i = 0;
-	for (move = 11; move <= 88; move++)
+	if (alpha_orig < beta_orig)
 	{
-		if (legalp(move, player, fp))
-		{
-			i++;
-		}
+		store_result(key, depth, result, alpha_orig, beta_orig, map_square(best_move, symmetry, FALSE), ctx);
 	}
-	return i;
+	return result;
 }
 
-int validp(int move)
+/**
+ * @brief Stores the result of a search with the window alpha, beta in the transposition table, as a bound when it
+ * fell outside the window. Nothing is stored once the search is being aborted, as its results are meaningless.
+ * Results from opts.shared deep go to the distributed table as well, except from helper threads, which make no MPI
+ * calls.
+ *
+ * @param key
+ * @param depth
+ * @param result
+ * @param alpha
+ * @param beta
+ * @param move
+ * @param ctx
+ */
+void store_result(uint64_t key, int depth, int result, int alpha, int beta, int move, search_context *ctx)
 {
-	if ((move >= 11) && (move <= 88) && (move % 10 >= 1) && (move % 10 <= 8))
-		return 1;
-	else
-		return 0;
-}
+	int bound;
 
-int would_flip(int move, int dir, int player, FILE *fp)
-{
-	int c;
-	c = move + dir;
-	if (board[c] == opponent(player, fp))
-		return find_bracket_piece(c + dir, dir, player, fp);
+	if (ctx->aborted)
+		return;
+	if (result <= alpha)
+		bound = TT_UPPER;
+	else if (result >= beta)
+		bound = TT_LOWER;
 	else
-		return 0;
+		bound = TT_EXACT;
+	tt_store(key, depth, bound, result, move);
+	if (opts.shared > 0 && depth >= opts.shared && !ctx->helper)
+		tt_shared_store(key, depth, bound, result, move);
 }
 
-int find_bracket_piece(int square, int dir, int player, FILE *fp)
-{
-	while (board[square] == opponent(player, fp))
-		square = square + dir;
-	if (board[square] == player)
-		return square;
-	else
-		return 0;
-}
 
-int opponent(int player, FILE *fp)
+/**
+ * @brief Puts the moves of player in the order they are searched and returns how many there are.
+ * The transposition table move goes first, then the killer moves of this ply, then the rest by the class of
+ * their square in the weights table, by how few replies they leave the opponent and by their history count.
+ *
+ * @param pos
+ * @param moves
+ * @param player
+ * @param tt_move
+ * @param ply
+ * @param list
+ * @param ctx
+ * @return int
+ */
+int order_moves(position *pos, uint64_t moves, int player, int tt_move, int ply, int *list, search_context *ctx)
 {
-	if (player == BLACK)
-		return WHITE;
-	if (player == WHITE)
-		return BLACK;
-	fprintf(fp, "illegal player\n");
-	return EMPTY;
+	int keys[LEGALMOVSBUFSIZE];
+	int opp = opponent(player, ctx->log);
+	int n, i, bit, move, key;
+	uint64_t flips, own, other;
+
+	for (n = 0; moves; moves &= moves - 1, n++)
+	{
+		bit = bb_first(moves);
+		move = bb_to_square(bit);
+		if (move == tt_move)
+		{
+			key = 1 << 30;
+		}
+		else if (move == ctx->killers[ply][0] || move == ctx->killers[ply][1])
+		{
+			key = (move == ctx->killers[ply][0]) ? 1 << 29 : 1 << 28;
+		}
+		else
+		{
+			flips = bb_flips(bit, pos->discs[player], pos->discs[opp]);
+			own = pos->discs[player] | flips | BB_BIT(bit);
+			other = pos->discs[opp] ^ flips;
+			key = 64 * weights[move] - 256 * bb_count(bb_moves(other, own)) + ctx->history[player][move];
+		}
+		// Insertion sort, there are rarely more than a dozen moves
+		for (i = n; i > 0 && keys[i - 1] < key; i--)
+		{
+			keys[i] = keys[i - 1];
+			list[i] = list[i - 1];
+		}
+		keys[i] = key;
+		list[i] = move;
+	}
+	return n;
 }
 
-int random_strategy(int my_colour, FILE *fp)
+/**
+ * @brief Drops from moves[1..moves[0]] every move of player that leads to a mirror image of where an earlier move
+ * leads, which must score the same, and returns how many are left. The moves keep their order. From the start
+ * position all four moves are one, and from a few plies on there is rarely anything to drop.
+ *
+ * @param pos
+ * @param player
+ * @param moves
+ * @param fp
+ * @return int
+ */
+int drop_symmetric_moves(position *pos, int player, int *moves, FILE *fp)
 {
-	int r;
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
+	uint64_t own[LEGALMOVSBUFSIZE], opp[LEGALMOVSBUFSIZE];
+	uint64_t flips;
+	int i, j, n, bit, other = opponent(player, fp);
 
-	legal_moves(my_colour, moves, fp);
-	if (moves[0] == 0)
+	for (n = 0, i = 1; i <= moves[0]; i++)
 	{
-		return -1;
+		bit = bb_from_square(moves[i]);
+		flips = bb_flips(bit, pos->discs[player], pos->discs[other]);
+		own[n] = pos->discs[player] | flips | BB_BIT(bit);
+		opp[n] = pos->discs[other] ^ flips;
+		bb_canonical(&own[n], &opp[n]);
+		for (j = 0; j < n && (own[j] != own[n] || opp[j] != opp[n]); j++)
+			;
+		if (j == n)
+			moves[++n] = moves[i];
 	}
-	srand(time(NULL));
-	r = moves[(rand() % moves[0]) + 1];
-	free(moves);
-	return (r);
+	return n;
 }
 
-void make_move(int move, int player, FILE *fp)
+/**
+ * @brief Returns the square a move on square lands on under a symmetry of bb_transform, or with inverse the square
+ * it came from. 0, which stands for no move, stays 0.
+ *
+ * @param square
+ * @param symmetry
+ * @param inverse
+ * @return int
+ */
+int map_square(int square, int symmetry, int inverse)
 {
-	int i;
-	board[move] = player;
-	for (i = 0; i <= 7; i++)
-		make_flips(move, ALLDIRECTIONS[i], player, fp);
+	uint64_t b;
+
+	if (square == 0 || symmetry == 0)
+		return square;
+	b = BB_BIT(bb_from_square(square));
+	b = inverse ? bb_untransform(b, symmetry) : bb_transform(b, symmetry);
+	return bb_to_square(bb_first(b));
 }
 
-void make_flips(int move, int dir, int player, FILE *fp)
+/**
+ * @brief Sorts all but the first of the moves by move_cost, most costly first. Moves with no cost keep their order
+ * after the others.
+ *
+ * @param moves
+ */
+void order_by_cost(int *moves)
 {
-	int bracketer, c;
-	bracketer = would_flip(move, dir, player, fp);
-	if (bracketer)
+	int i, j, move;
+	for (i = 3; i <= moves[0]; i++)
 	{
-		c = move + dir;
-		do
+		move = moves[i];
+		for (j = i; j > 2 && move_cost[moves[j - 1]] < move_cost[move]; j--)
 		{
-			board[c] = player;
-			c = c + dir;
-		} while (c != bracketer);
+			moves[j] = moves[j - 1];
+		}
+		moves[j] = move;
 	}
 }
 
-void print_board(FILE *fp)
+/**
+ * @brief Sorts moves[1..moves[0]] by descending scores, keeping the two arrays paired.
+ *
+ * @param moves
+ * @param scores
+ */
+void sort_moves(int *moves, int *scores)
 {
-	int row, col;
-	fprintf(fp, "   1 2 3 4 5 6 7 8 [%c=%d %c=%d]\n",
-			nameof(BLACK), evaluate(BLACK, board, fp), nameof(WHITE), evaluate(WHITE, board, fp));
-	for (row = 1; row <= 8; row++)
+	int i, j, move, score;
+	for (i = 2; i <= moves[0]; i++)
 	{
-		fprintf(fp, "%d  ", row);
-		for (col = 1; col <= 8; col++)
-			fprintf(fp, "%c ", nameof(board[col + (10 * row)]));
-		fprintf(fp, "\n");
+		move = moves[i];
+		score = scores[i];
+		for (j = i; j > 1 && scores[j - 1] < score; j--)
+		{
+			moves[j] = moves[j - 1];
+			scores[j] = scores[j - 1];
+		}
+		moves[j] = move;
+		scores[j] = score;
 	}
-	fflush(fp);
-}
-
-char nameof(int piece)
-{
-	assert(0 <= piece && piece < 5);
-	return (piecenames[piece]);
 }
 
-int count(int player, int *board)
+/**
+ * @brief Halves the history counts of ctx at the start of each move, so that old cutoffs fade out, and clears the
+ * killers.
+ *
+ * @param ctx
+ */
+void age_history(search_context *ctx)
 {
-	int i, cnt;
-	cnt = 0;
-	for (i = 1; i <= 88; i++)
-		if (board[i] == player)
-			cnt++;
-	return cnt;
+	int colour, square;
+	for (colour = 0; colour < 3; colour++)
+		for (square = 0; square < BOARDSIZE; square++)
+			ctx->history[colour][square] /= 2;
+	memset(ctx->killers, 0, sizeof(ctx->killers));
 }
 
 /**
- * @brief A function to iteratively run through the moves available and increase the depth based on the amount.
- * Used to increase the speed of the program.
+ * @brief Maps an exact final disc differential (from the point of view of the side searched for) onto the score
+ * scale of evaluate. Any win scores above any heuristic score and any loss below, so exact results always take
+ * precedence.
  *
- * @param moves
+ * @param discs
  * @return int
  */
-int dynamic_depth(int moves)
+int endgame_score(int discs)
 {
-	if (moves >= 3 && moves < 8)
-	{
-		return 6;
-	}
+	if (discs > 0)
+		return WIN_SCORE + discs;
+	if (discs < 0)
+		return -WIN_SCORE + discs;
+	return 0;
+}
 
-	else if (moves >= 8 && moves < 15)
-	{
-		return 5;
-	}
+/* Final disc differential for own, with the empty squares going to the winner */
+int final_discs(uint64_t own, uint64_t opp)
+{
+	int o = bb_count(own);
+	int p = bb_count(opp);
+	int e = BB_SQUARES - o - p;
+	if (o > p)
+		return o - p + e;
+	if (o < p)
+		return o - p - e;
+	return 0;
+}
 
-	else if (moves >= 15)
-	{
-		return 4;
-	}
+/* Quadrant of a bit, for the parity of the empty regions */
+int quadrant(int bit)
+{
+	return ((bit >= 32) << 1) | ((bit & 7) >= 4);
+}
 
-	else if (size == 1)
-	{
-		return 0;
-	}
+/*
+ * The exact solver keeps the empty squares in a linked list in its search_context, best squares first, so that the
+ * last few plies can try the empties directly instead of generating moves. empty_parity has a bit set for every
+ * quadrant with an odd number of empties; moves into those quadrants are tried first.
+ */
 
-	else
-	{
-		return 7;
-	}
+/* Squares in the order the empty list keeps them: corners, edges, inner squares, then X and C squares */
+const int SOLVE_ORDER[BB_SQUARES] = {
+	0, 7, 56, 63, 2, 5, 16, 23, 40, 47, 58, 61, 3, 4, 24, 31, 32, 39, 59, 60,
+	18, 21, 42, 45, 19, 20, 26, 29, 34, 37, 43, 44, 27, 28, 35, 36,
+	10, 11, 12, 13, 17, 22, 25, 30, 33, 38, 41, 46, 50, 51, 52, 53,
+	1, 6, 8, 15, 48, 55, 57, 62, 9, 14, 49, 54};
 
-	return 2;
+void remove_empty(int bit, search_context *ctx)
+{
+	ctx->empty_next[ctx->empty_prev[bit]] = ctx->empty_next[bit];
+	ctx->empty_prev[ctx->empty_next[bit]] = ctx->empty_prev[bit];
+	ctx->empty_parity ^= 1 << quadrant(bit);
 }
+
+void restore_empty(int bit, search_context *ctx)
+{
+	ctx->empty_next[ctx->empty_prev[bit]] = bit;
+	ctx->empty_prev[ctx->empty_next[bit]] = bit;
+	ctx->empty_parity ^= 1 << quadrant(bit);
+}
+
 /**
- * @brief The minimax starter function, obtains the legal moves of the player and the depth from the dynamic_depth
- * function.
- * computes the result from the alpha beta function with -10000 and 10000 as the alpha and beta functions respectively.
+ * @brief Negamax search to the end of the game. Returns the final disc differential for the side owning own,
+ * within alpha and beta. Passes are searched as a move of the other side; the game ends when neither side
+ * can move. Above FASTEST_FIRST_EMPTIES the moves are tried in fastest-first order, below it the empties are
+ * tried straight from the list, odd regions first.
  *
- * @param move
- * @param colour
- * @param sent_board
- * @param fp
+ * @param own
+ * @param opp
+ * @param alpha
+ * @param beta
+ * @param empties
+ * @param passed
+ * @param ctx
  * @return int
  */
-int minimax(int move, int colour, int *sent_board, FILE *fp)
+int solve(uint64_t own, uint64_t opp, int alpha, int beta, int empties, int passed, search_context *ctx)
 {
-	int result, depth;
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-	legal_moves(my_colour, moves, fp);
-	int moves_avail = moves[0];
-	depth = dynamic_depth(moves_avail);
-	// printf("Depth:%d\n",depth);
-	free(moves);
-
-	result = alpha_beta(move, -10000, 10000, colour, depth, sent_board, fp);
-
-	return result;
-}
-
-int alpha_beta(int move_made, int alpha, int beta, int colour, int depth, int *sent_board, FILE *fp)
-{
-	int *new_board;
-	int result;
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-	legal_moves(my_colour, moves, fp);
-	// Makes my move
-	new_board = copy_board(sent_board);
+	int keys[LEGALMOVSBUFSIZE], bits[LEGALMOVSBUFSIZE];
+	int best, score, bit, n, i, j, pass, key;
+	uint64_t moves, flips;
 
-	if (depth == 0)
+	if (search_interrupted(ctx))
 	{
-		return evaluate(my_colour, new_board, fp);
+		return 0;
 	}
-	// Gets the opponent legal moves
-	make_move(move_made, colour, fp);
-	new_board = copy_board(sent_board);
-	legal_moves(opponent(colour, fp), moves, fp);
-	// Checking if there no moves
-	if (moves[0] == 0)
+	if (empties == 0)
 	{
-		free(moves);
-		return evaluate(my_colour, new_board, fp);
+		return final_discs(own, opp);
 	}
-	// Loop through the opponents set of moves and run the alpha beta
-	for (int i = 1; i <= moves[0]; i++)
-	{
-
-		result = alpha_beta(moves[i], alpha, beta, opponent(colour, fp), depth - 1, new_board, fp);
-		board = copy_board(new_board);
-		make_move(moves[i], colour, fp);
 
-		if (colour == my_colour)
+	best = -BB_SQUARES - 1;
+	if (empties > FASTEST_FIRST_EMPTIES)
+	{
+		moves = bb_moves(own, opp);
+		for (n = 0; moves; moves &= moves - 1, n++)
 		{
-			if (result > alpha)
+			bit = bb_first(moves);
+			flips = bb_flips(bit, own, opp);
+			key = bb_count(bb_moves(opp ^ flips, own | flips | BB_BIT(bit)));
+			for (i = n; i > 0 && keys[i - 1] > key; i--)
 			{
-				alpha = result;
+				keys[i] = keys[i - 1];
+				bits[i] = bits[i - 1];
 			}
+			keys[i] = key;
+			bits[i] = bit;
 		}
-		else
+		for (i = 0; i < n; i++)
 		{
-			if (result < beta)
+			bit = bits[i];
+			flips = bb_flips(bit, own, opp);
+			remove_empty(bit, ctx);
+			score = -solve(opp ^ flips, own | flips | BB_BIT(bit), -beta, -alpha, empties - 1, FALSE, ctx);
+			restore_empty(bit, ctx);
+			if (score > best)
 			{
-				beta = result;
+				best = score;
+				if (best > alpha)
+					alpha = best;
+				if (alpha >= beta)
+					return best;
 			}
 		}
-		// Prune
-		if (alpha >= beta)
+	}
+	else
+	{
+		n = 0;
+		for (pass = 0; pass < 2; pass++)
 		{
-			break;
+			for (bit = ctx->empty_next[BB_SQUARES]; bit != BB_SQUARES; bit = ctx->empty_next[bit])
+			{
+				j = (ctx->empty_parity >> quadrant(bit)) & 1;
+				if (j != (pass == 0))
+					continue;
+				flips = bb_flips(bit, own, opp);
+				if (flips == 0)
+					continue;
+				n++;
+				remove_empty(bit, ctx);
+				score = -solve(opp ^ flips, own | flips | BB_BIT(bit), -beta, -alpha, empties - 1, FALSE, ctx);
+				restore_empty(bit, ctx);
+				if (score > best)
+				{
+					best = score;
+					if (best > alpha)
+						alpha = best;
+					if (alpha >= beta)
+						return best;
+				}
+			}
 		}
 	}
 
-	free(moves);
-	free(new_board);
-	if (colour == my_colour)
+	if (n == 0)
 	{
-
-		return alpha;
-	}
-	else
-	{
-		return beta;
+		if (passed)
+			return final_discs(own, opp);
+		return -solve(opp, own, -beta, -alpha, empties, TRUE, ctx);
 	}
+	return best;
 }
 
-
 /**
- * @brief The game_stage function was inspired by a tutorial session where the demi informed me that
- * I would need to account for the later stages of the game and apply increased weights to the evaluation
- * function so that the minimax would not just pick the higher weight but rather where it would win.
+ * @brief Solves pos exactly with player to move and returns the score from the side of ctx, on the
+ * scale of endgame_score. The window is turned into the tightest disc window that still settles alpha and beta.
  *
+ * @param pos
+ * @param player
+ * @param alpha
+ * @param beta
+ * @param ctx
  * @return int
  */
-int game_stage()
+int endgame_search(position *pos, int player, int alpha, int beta, search_context *ctx)
 {
-	int i;
-	int pcoins;
-	int ocoins;
-	int opp = opponent(my_colour, fp);
-	int total, stage;
+	int low = -BB_SQUARES - 1, high = BB_SQUARES + 1;
+	int d, i, bit, empties, result;
+	uint64_t empty = ~(pos->discs[BLACK] | pos->discs[WHITE]);
 
-	pcoins = 0;
-	ocoins = 0;
-	stage = 0;
+	for (d = -BB_SQUARES; d <= BB_SQUARES; d++)
+	{
+		if (endgame_score(d) <= alpha)
+			low = d;
+		if (endgame_score(d) >= beta && high == BB_SQUARES + 1)
+			high = d;
+	}
 
-	for (i = 1; i <= 88; i++)
+	// Builds the empty list in SOLVE_ORDER
+	ctx->empty_parity = 0;
+	empties = 0;
+	ctx->empty_prev[BB_SQUARES] = BB_SQUARES;
+	for (i = 0; i < BB_SQUARES; i++)
 	{
-		if (board[i] == my_colour)
-		{
-			pcoins++;
-		}
-		else if (board[i] == opp)
+		bit = SOLVE_ORDER[i];
+		if (empty & BB_BIT(bit))
 		{
-			ocoins++;
+			ctx->empty_next[ctx->empty_prev[BB_SQUARES]] = bit;
+			ctx->empty_prev[bit] = ctx->empty_prev[BB_SQUARES];
+			ctx->empty_prev[BB_SQUARES] = bit;
+			ctx->empty_parity ^= 1 << quadrant(bit);
+			empties++;
 		}
 	}
+	ctx->empty_next[ctx->empty_prev[BB_SQUARES]] = BB_SQUARES;
 
-	total = pcoins + ocoins;
-
-	if (total <= 20)
+	if (player == ctx->side)
 	{
-		stage = 1;
+		result = solve(pos->discs[player], pos->discs[opponent(player, ctx->log)], low, high, empties, FALSE, ctx);
 	}
-	else if (total > 20 && total <= 40)
-	{
-		stage = 2;
-	}
-	else if (total > 40)
+	else
 	{
-		stage = 3;
+		result = -solve(pos->discs[player], pos->discs[opponent(player, ctx->log)], -high, -low, empties, FALSE, ctx);
 	}
-
-	return stage;
+	return endgame_score(result);
 }
 
-/*
-This evaluation function is inspired by mr peter sieg and a blog for a really good evaluation function that takes into
-account several other heurisitcs such as coin parity, mobility and stability. This combined with the game_state function
-gives me an optimal to play the othello game:
-References are:
-Blog: https://kartikkukreja.wordpress.com/2013/03/30/heuristic-function-for-reversiothello/
-Mr peter sieg github: https://github.com/petersieg/c
-*/
-int evaluate(int player, int *board, FILE *fp)
+/**
+ * @brief The game_stage of pos, from the number of discs on it, see disc_stage
+ *
+ * @param pos
+ * @return int
+ */
+int game_stage(position *pos)
 {
-	int i;
-	int pcnt, pcoins, pmoves;
-	int opp, ocnt, ocoins, omoves;
-	int position, parity, mobility, final;
-	// opponent characteristics:
-	opp = opponent(player, fp);
-	ocnt = 0;
-	ocoins = 0;
-	omoves = num_valid_moves(player, board, fp);
-	// player characteristics:
-	pcnt = 0;
-	pcoins = 0;
-	pmoves = num_valid_moves(player, board, fp);
+	return disc_stage(bb_count(pos->discs[BLACK] | pos->discs[WHITE]));
+}
 
-	for (i = 1; i <= 88; i++)
+/**
+ * @brief Loads the ProbCut fits from path into probcut. Every line other than a comment starting with # is one fit:
+ * the game_stage and depth it is for, the shallow depth and then a, b and sigma, as tools/fit_probcut.c writes them.
+ *
+ * @param path
+ * @return int
+ */
+int load_probcut(char *path)
+{
+	FILE *in = fopen(path, "r");
+	char line[CMDBUFSIZE];
+	int stage, depth, shallow, fits = 0;
+	float a, b, sigma;
+
+	if (in == NULL)
+		return FAILURE;
+	memset(probcut, 0, sizeof(probcut));
+	while (fgets(line, sizeof(line), in) != NULL)
 	{
-		if (board[i] == player)
-		{
-			pcnt = pcnt + weights[i];
-			pcoins++;
-		}
-		else if (board[i] == opp)
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (sscanf(line, "%d %d %d %f %f %f", &stage, &depth, &shallow, &a, &b, &sigma) != 6 || stage < 1 ||
+			stage > 3 || depth < PROBCUT_MIN_DEPTH || depth >= MAXPLY || shallow < 1 || shallow >= depth || a <= 0 ||
+			sigma < 0)
 		{
-			ocnt = ocnt + weights[i];
-			ocoins++;
+			fprintf(stderr, "Bad ProbCut fit %s", line);
+			fclose(in);
+			return FAILURE;
 		}
+		probcut[stage][depth].shallow = shallow;
+		probcut[stage][depth].a = a;
+		probcut[stage][depth].b = b;
+		probcut[stage][depth].sigma = sigma;
+		fits++;
 	}
-	position = (pcnt - ocnt);
+	fclose(in);
+	return fits > 0 ? SUCCESS : FAILURE;
+}
 
-	// Parity:
-	parity = 100 * (pcoins - ocoins) / (pcoins + ocoins);
-	// Mobility:
-	if ((pmoves + omoves) != 0)
+/**
+ * @brief ProbCut at the node alpha_beta has made move_made for, which is to be searched to depth with a null window
+ * and has mover to move. From the fit for its stage and depth, the node is searched to the shallow depth instead with
+ * null windows at the scores beyond which the full search would be PROBCUT_SIGMAS typical errors above beta, or as far
+ * below alpha. If the shallow search gets past either, the full one is taken to fail the same way: TRUE is returned
+ * with the bound it fails on in result. The shallow searches lie outside the window of the job more often than not,
+ * so they keep their own windows rather than be narrowed to it.
+ *
+ * @param move_made
+ * @param alpha
+ * @param beta
+ * @param colour
+ * @param depth
+ * @param ply
+ * @param mover
+ * @param result
+ * @param ctx
+ * @return int
+ */
+int probcut_cut(int move_made, int alpha, int beta, int colour, int depth, int ply, int mover, int *result,
+				search_context *ctx)
+{
+	probcut_fit *fit = &probcut[game_stage(&ctx->stack[ply + 1])][depth];
+	// The fit is from the side to move, the scores of the search are from ctx->side
+	double b = mover == ctx->side ? fit->b : -fit->b;
+	double margin = PROBCUT_SIGMAS * fit->sigma;
+	double limit;
+	int bound, cut = FALSE;
+
+	ctx->probing++;
+	// Rounded away from the window, which can only make a cut less likely
+	limit = (beta + margin - b) / fit->a;
+	bound = limit < WIN_SCORE ? (int)limit + 1 : WIN_SCORE;
+	if (bound < WIN_SCORE && alpha_beta(move_made, bound - 1, bound, colour, fit->shallow, ply, ctx) >= bound)
 	{
-		mobility = 100 * (pmoves - omoves) / (pmoves + omoves);
+		*result = beta;
+		cut = TRUE;
 	}
-	else
+	limit = (alpha - margin - b) / fit->a;
+	bound = limit > -WIN_SCORE ? (int)limit - 1 : -WIN_SCORE;
+	if (!cut && bound > -WIN_SCORE && alpha_beta(move_made, bound, bound + 1, colour, fit->shallow, ply, ctx) <= bound)
 	{
-		mobility = 0;
-	}
-	/*Programs runs with just the above*/
-	// Corners Captured
-	ocoins = pcoins = 0;
-	if (board[11] == player)
-		pcoins++;
-	else if (board[11] == opp)
-		ocoins++;
-
-	if (board[18] == player)
-		pcoins++;
-	else if (board[18] == opp)
-		ocoins++;
-
-	if (board[81] == player)
-		pcoins++;
-	else if (board[81] == opp)
-		ocoins++;
-
-	if (board[88] == player)
-		pcoins++;
-	else if (board[88] == opp)
-		ocoins++;
-
-	int corner_occ = 25 * (pcoins - ocoins);
-
-	// Corner Closeness:
-	ocoins = pcoins = 0;
-	if (board[11] == '.')
-	{
-		if (board[12] == player)
-			pcoins++;
-		else if (board[12] == opp)
-			ocoins++;
-		if (board[22] == player)
-			pcoins++;
-		else if (board[22] == opp)
-			ocoins++;
-		if (board[21] == player)
-			pcoins++;
-		else if (board[21] == opp)
-			ocoins++;
-	}
-	if (board[18] == '.')
-	{
-		if (board[17] == player)
-			pcoins++;
-		else if (board[17] == opp)
-			ocoins++;
-		if (board[27] == player)
-			pcoins++;
-		else if (board[27] == opp)
-			ocoins++;
-		if (board[28] == player)
-			pcoins++;
-		else if (board[28] == opp)
-			ocoins++;
-	}
-
-	if (board[81] == '.')
-	{
-		if (board[82] == player)
-			pcoins++;
-		else if (board[82] == opp)
-			ocoins++;
-		if (board[72] == player)
-			pcoins++;
-		else if (board[72] == opp)
-			ocoins++;
-		if (board[71] == player)
-			pcoins++;
-		else if (board[71] == opp)
-			ocoins++;
-	}
-
-	if (board[88] == '.')
-	{
-		if (board[78] == player)
-			pcoins++;
-		else if (board[78] == opp)
-			ocoins++;
-		if (board[77] == player)
-			pcoins++;
-		else if (board[77] == opp)
-			ocoins++;
-		if (board[87] == player)
-			pcoins++;
-		else if (board[87] == opp)
-			ocoins++;
-	}
-
-	int cc = -12.5 * (pcoins - ocoins);
-
-	mobility = (3 - game_stage()) * mobility;
-
-	final = position + (10 * parity) + (78.922 * mobility) + (801.724 * corner_occ) + (382.026 * cc);
-	return final;
+		*result = alpha;
+		cut = TRUE;
+	}
+	ctx->probing--;
+	// A test cut short by the deadline proves nothing, and the caller gives up anyway
+	return cut && !ctx->aborted;
+}
+
+/**
+ * @brief Scores pos from player's point of view with evaluate, from the square weights pos keeps
+ *
+ * @param player
+ * @param pos
+ * @return int
+ */
+int heuristic_score(int player, position *pos)
+{
+	int opp = opponent(player, fp);
+
+	return evaluate(pos->discs[player], pos->discs[opp], pos->weight[player], pos->weight[opp]);
+}
+
+/**
+ * @brief Scores pos from player's point of view with the pattern evaluator, kept short of the scores of won
+ * and lost endgames
+ *
+ * @param player
+ * @param pos
+ * @return int
+ */
+int pattern_score(int player, position *pos)
+{
+	int score = pattern_evaluate(pos->discs[player], pos->discs[opponent(player, fp)]);
+
+	if (score >= WIN_SCORE)
+		return WIN_SCORE - 1;
+	if (score <= -WIN_SCORE)
+		return -WIN_SCORE + 1;
+	return score;
 }
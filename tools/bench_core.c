@@ -0,0 +1,324 @@
+/*
+ * Micro-benchmarks of the engine core, without MPI or the referee.
+ *
+ *   bench_core [perft depth] [patterns file]
+ *
+ * Times legal move generation, making and unmaking moves, evaluate and the pattern evaluator on a fixed set of
+ * positions from random games, then counts the full game tree from the start position to the perft depth (default
+ * 9). Every benchmark is run for the bitboards of bitboard.c, which the engine searches on, and for a 10x10 mailbox
+ * board generating moves square by square as the engine first did, so the two can be compared. The perft counts of both
+ * are checked against the known values and the exit status is 1 if any of them is wrong. The first line names the
+ * version of bb_moves the CPU runs.
+ *
+ * Without a patterns file the pattern evaluator runs on weights that are all zero, which costs the same.
+ *
+ * Compile with: cc -O2 -I. -o bench_core tools/bench_core.c bitboard.c eval.c pattern.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../bitboard.h"
+#include "../comms.h"
+#include "../eval.h"
+#include "../pattern.h"
+
+#define POSITIONS 1000
+#define MAX_PERFT 11
+#define TARGET_SECONDS 0.5
+
+/* Leaves of the game tree from the start position by depth, a pass counting as a ply and a finished game as a leaf */
+static const long PERFT[MAX_PERFT + 1] = {1, 4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284, 212258800};
+
+static const int DIRECTIONS[8] = {-11, -10, -9, -1, 1, 9, 10, 11};
+
+/* Own and opponent discs of the side to move, in both representations, and the square weights evaluate takes */
+typedef struct sample
+{
+	uint64_t own, opp;
+	int own_weight, opp_weight;
+	int board[100];
+} sample;
+
+static sample samples[POSITIONS];
+static volatile long sink;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *bench, const char *backend, long calls, double seconds)
+{
+	printf("{\"bench\": \"%s\", \"backend\": \"%s\", \"calls\": %ld, \"ns_per_call\": %.1f}\n", bench, backend, calls,
+		   calls > 0 ? seconds * 1e9 / calls : 0.0);
+}
+
+/* Mailbox board: 1 for the side to move, 2 for the opponent, 0 empty and 3 off the board */
+
+static void to_mailbox(uint64_t own, uint64_t opp, int *board)
+{
+	int i, bit;
+
+	for (i = 0; i < 100; i++)
+		board[i] = (i % 10 >= 1 && i % 10 <= 8 && i >= 11 && i <= 88) ? 0 : 3;
+	for (bit = 0; bit < BB_SQUARES; bit++)
+	{
+		if (own & BB_BIT(bit))
+			board[bb_to_square(bit)] = 1;
+		else if (opp & BB_BIT(bit))
+			board[bb_to_square(bit)] = 2;
+	}
+}
+
+/* The square that closes a run of opponent discs from square in direction dir, 0 if there is none */
+static int mailbox_bracket(const int *board, int square, int dir, int player)
+{
+	int other = 3 - player;
+	int s = square + dir;
+
+	if (board[s] != other)
+		return 0;
+	while (board[s] == other)
+		s += dir;
+	return board[s] == player ? s : 0;
+}
+
+static int mailbox_legal(const int *board, int square, int player)
+{
+	int dir;
+
+	if (board[square] != 0)
+		return 0;
+	for (dir = 0; dir < 8; dir++)
+	{
+		if (mailbox_bracket(board, square, DIRECTIONS[dir], player))
+			return 1;
+	}
+	return 0;
+}
+
+static int mailbox_moves(const int *board, int player, int *moves)
+{
+	int square, n = 0;
+
+	for (square = 11; square <= 88; square++)
+	{
+		if (mailbox_legal(board, square, player))
+			moves[n++] = square;
+	}
+	return n;
+}
+
+/* Plays a legal move, writing the squares it flips into flipped, and returns how many */
+static int mailbox_make(int *board, int square, int player, int *flipped)
+{
+	int dir, s, end, n = 0;
+
+	for (dir = 0; dir < 8; dir++)
+	{
+		end = mailbox_bracket(board, square, DIRECTIONS[dir], player);
+		for (s = square + DIRECTIONS[dir]; end && s != end; s += DIRECTIONS[dir])
+		{
+			board[s] = player;
+			flipped[n++] = s;
+		}
+	}
+	board[square] = player;
+	return n;
+}
+
+static void mailbox_unmake(int *board, int square, int player, const int *flipped, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		board[flipped[i]] = 3 - player;
+	board[square] = 0;
+}
+
+static long perft_mailbox(int *board, int player, int depth, int passed)
+{
+	int moves[64], flipped[64];
+	int i, n, f;
+	long leaves = 0;
+
+	if (depth == 0)
+		return 1;
+	n = mailbox_moves(board, player, moves);
+	if (n == 0)
+		return passed ? 1 : perft_mailbox(board, 3 - player, depth - 1, 1);
+	for (i = 0; i < n; i++)
+	{
+		f = mailbox_make(board, moves[i], player, flipped);
+		leaves += perft_mailbox(board, 3 - player, depth - 1, 0);
+		mailbox_unmake(board, moves[i], player, flipped, f);
+	}
+	return leaves;
+}
+
+static long perft_bitboard(uint64_t own, uint64_t opp, int depth, int passed)
+{
+	uint64_t moves, flips;
+	int bit;
+	long leaves = 0;
+
+	if (depth == 0)
+		return 1;
+	moves = bb_moves(own, opp);
+	if (moves == 0)
+		return passed ? 1 : perft_bitboard(opp, own, depth - 1, 1);
+	for (; moves; moves &= moves - 1)
+	{
+		bit = bb_first(moves);
+		flips = bb_flips(bit, own, opp);
+		leaves += perft_bitboard(opp ^ flips, own | flips | BB_BIT(bit), depth - 1, 0);
+	}
+	return leaves;
+}
+
+/* Positions after 10 to 50 random moves from the start, with the same seed every run */
+static void make_samples()
+{
+	uint64_t own, opp, moves, flips, t;
+	uint64_t state = 0x73696d6f6eULL;
+	int i, ply, plies, bit, k;
+
+	for (i = 0; i < POSITIONS; i++)
+	{
+		own = BB_BIT(28) | BB_BIT(35);
+		opp = BB_BIT(27) | BB_BIT(36);
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		plies = 10 + (state >> 33) % 41;
+		for (ply = 0; ply < plies; ply++)
+		{
+			moves = bb_moves(own, opp);
+			if (moves == 0)
+			{
+				if (bb_moves(opp, own) == 0)
+					break;
+			}
+			else
+			{
+				state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+				for (k = (state >> 33) % bb_count(moves); k > 0; k--)
+					moves &= moves - 1;
+				bit = bb_first(moves);
+				flips = bb_flips(bit, own, opp);
+				own |= flips | BB_BIT(bit);
+				opp ^= flips;
+			}
+			t = own;
+			own = opp;
+			opp = t;
+		}
+		samples[i].own = own;
+		samples[i].opp = opp;
+		samples[i].own_weight = square_weights(own);
+		samples[i].opp_weight = square_weights(opp);
+		to_mailbox(own, opp, samples[i].board);
+	}
+}
+
+/* Runs body on every sample until TARGET_SECONDS have gone by and reports the time per call, body counts the calls */
+#define TIMED(bench, backend, body)                                                                                    \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		long calls = 0;                                                                                                \
+		double start = now(), elapsed;                                                                                 \
+		do                                                                                                             \
+		{                                                                                                              \
+			for (i = 0; i < POSITIONS; i++)                                                                            \
+			{                                                                                                          \
+				body;                                                                                                  \
+			}                                                                                                          \
+			elapsed = now() - start;                                                                                   \
+		} while (elapsed < TARGET_SECONDS);                                                                            \
+		report(bench, backend, calls, elapsed);                                                                        \
+	} while (0)
+
+int main(int argc, char *argv[])
+{
+	int depth = argc > 1 ? atoi(argv[1]) : 9;
+	int moves[64], flipped[64];
+	int i, j, n, f, failed = 0;
+	uint64_t legal, flips;
+	int start[100];
+	long leaves;
+	double t;
+
+	if (depth < 0 || depth > MAX_PERFT)
+	{
+		fprintf(stderr, "The perft depth must be from 0 to %d\n", MAX_PERFT);
+		return 1;
+	}
+	if (argc > 2 ? pattern_load(argv[2]) == FAILURE : pattern_alloc() == FAILURE)
+	{
+		fprintf(stderr, "Could not load the pattern weights\n");
+		return 1;
+	}
+	make_samples();
+	printf("{\"bench\": \"dispatch\", \"bb_moves\": \"%s\"}\n", bb_backend());
+
+	TIMED("moves", "bitboard", {
+		sink += bb_moves(samples[i].own, samples[i].opp);
+		calls++;
+	});
+	TIMED("moves", "mailbox", {
+		sink += mailbox_moves(samples[i].board, 1, moves);
+		calls++;
+	});
+
+	TIMED("make_unmake", "bitboard", {
+		for (legal = bb_moves(samples[i].own, samples[i].opp); legal; legal &= legal - 1)
+		{
+			flips = bb_flips(bb_first(legal), samples[i].own, samples[i].opp);
+			samples[i].own ^= flips | (legal & -legal);
+			samples[i].opp ^= flips;
+			sink += samples[i].own;
+			samples[i].own ^= flips | (legal & -legal);
+			samples[i].opp ^= flips;
+			calls++;
+		}
+	});
+	TIMED("make_unmake", "mailbox", {
+		n = mailbox_moves(samples[i].board, 1, moves);
+		for (j = 0; j < n; j++)
+		{
+			f = mailbox_make(samples[i].board, moves[j], 1, flipped);
+			sink += f;
+			mailbox_unmake(samples[i].board, moves[j], 1, flipped, f);
+			calls++;
+		}
+	});
+
+	TIMED("evaluate", "heuristic", {
+		sink += evaluate(samples[i].own, samples[i].opp, samples[i].own_weight, samples[i].opp_weight);
+		calls++;
+	});
+	TIMED("evaluate", "patterns", {
+		sink += pattern_evaluate(samples[i].own, samples[i].opp);
+		calls++;
+	});
+
+	for (n = 0; n < 2; n++)
+	{
+		// The start position of initialise_board, black to move
+		to_mailbox(BB_BIT(28) | BB_BIT(35), BB_BIT(27) | BB_BIT(36), start);
+		t = now();
+		leaves = n == 0 ? perft_bitboard(BB_BIT(28) | BB_BIT(35), BB_BIT(27) | BB_BIT(36), depth, 0)
+						: perft_mailbox(start, 1, depth, 0);
+		t = now() - t;
+		printf("{\"bench\": \"perft\", \"backend\": \"%s\", \"depth\": %d, \"nodes\": %ld, \"expected\": %ld, "
+			   "\"ok\": %s, \"seconds\": %.3f}\n",
+			   n == 0 ? "bitboard" : "mailbox", depth, leaves, PERFT[depth], leaves == PERFT[depth] ? "true" : "false",
+			   t);
+		if (leaves != PERFT[depth])
+			failed = 1;
+	}
+	pattern_free();
+	return failed;
+}
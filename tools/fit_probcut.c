@@ -0,0 +1,109 @@
+/*
+ * Fits the ProbCut parameters of the engine (probcut= option) from the score pairs a benchmark logs with fit=.
+ *
+ *   fit_probcut <benchmark logs...> > probcut.txt
+ *
+ * The pairs are a shallow and a deep full-window search of the same node, both scored from the side to move there,
+ * as "bench selfplay <time_limit> <log> fit=<depth>" or a benchmark of positions writes them. For every game stage,
+ * depth and shallow depth with enough pairs, the deep score is fitted as a * shallow + b by least squares, and sigma
+ * is the standard deviation of what is left over. Each fit is written as one line "stage depth shallow a b sigma"
+ * after a comment with the number of pairs it is from, which is the format the engine reads. Other lines of the logs
+ * are skipped.
+ *
+ * Compile with: cc -O2 -o fit_probcut tools/fit_probcut.c -lm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define STAGES 4
+#define MAX_DEPTH 64
+/* Fewer pairs than this make too rough a fit to prune on */
+#define MIN_PAIRS 30
+
+/* Sums over the pairs of one stage, depth and shallow depth, x the shallow score and y the deep one */
+typedef struct sums
+{
+	long n;
+	double x, y, xx, xy, yy;
+} sums;
+
+static sums cells[STAGES][MAX_DEPTH][MAX_DEPTH];
+
+static int read_log(const char *path)
+{
+	FILE *in = fopen(path, "r");
+	char line[512];
+	const char *pair;
+	int stage, depth, shallow, x, y;
+	sums *cell;
+
+	if (in == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		pair = strstr(line, "{\"probcut\": ");
+		if (pair == NULL ||
+			sscanf(pair, "{\"probcut\": {\"stage\": %d, \"depth\": %d, \"shallow_depth\": %d, \"shallow\": %d, "
+						 "\"deep\": %d}}",
+				   &stage, &depth, &shallow, &x, &y) != 5)
+			continue;
+		if (stage < 1 || stage >= STAGES || depth < 1 || depth >= MAX_DEPTH || shallow < 1 || shallow >= depth)
+			continue;
+		cell = &cells[stage][depth][shallow];
+		cell->n++;
+		cell->x += x;
+		cell->y += y;
+		cell->xx += (double)x * x;
+		cell->xy += (double)x * y;
+		cell->yy += (double)y * y;
+	}
+	fclose(in);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, stage, depth, shallow, failed = 0;
+	double sxx, sxy, syy, a, b, residual;
+	sums *cell;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: fit_probcut <benchmark logs...>\n");
+		return 1;
+	}
+	for (i = 1; i < argc; i++)
+		failed |= read_log(argv[i]);
+
+	printf("# stage depth shallow a b sigma\n");
+	for (stage = 1; stage < STAGES; stage++)
+	{
+		for (depth = 1; depth < MAX_DEPTH; depth++)
+		{
+			for (shallow = 1; shallow < depth; shallow++)
+			{
+				cell = &cells[stage][depth][shallow];
+				if (cell->n < MIN_PAIRS)
+					continue;
+				sxx = cell->xx - cell->x * cell->x / cell->n;
+				sxy = cell->xy - cell->x * cell->y / cell->n;
+				syy = cell->yy - cell->y * cell->y / cell->n;
+				// A shallow search that scores every node alike says nothing about the deep one
+				if (sxx <= 0 || sxy <= 0)
+					continue;
+				a = sxy / sxx;
+				b = (cell->y - a * cell->x) / cell->n;
+				residual = (syy - a * sxy) / (cell->n > 2 ? cell->n - 2 : 1);
+				printf("# %ld pairs\n%d %d %d %.4f %.1f %.1f\n", cell->n, stage, depth, shallow, a, b,
+					   sqrt(residual > 0 ? residual : 0));
+			}
+		}
+	}
+	return failed;
+}
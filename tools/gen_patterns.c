@@ -0,0 +1,265 @@
+/*
+ * Generator for the pattern evaluator (pattern.c).
+ *
+ *   gen_patterns header > pattern_tables.h
+ *       Writes the index tables: every pattern class is drawn once, and its instances are the distinct images of it
+ *       under the eight symmetries of the board. Rerun it after changing SHAPES and commit the result.
+ *
+ *   gen_patterns weights <file>
+ *       Writes a starting weights file that scores like the positional and corner terms of evaluate, to be tuned
+ *       from. A square's weight is shared out between the instances that cover it.
+ *
+ * Compile with: cc -O2 -o gen_patterns tools/gen_patterns.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define CLASSES 11
+#define MAX_SQUARES 10
+#define MAX_INSTANCES 64
+#define STAGES 6
+
+/* The squares of every class as bit indices, row * 8 + column from the top left, -1 terminated */
+static const int SHAPES[CLASSES][MAX_SQUARES + 1] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 9, 14, -1},	/* edge and both X squares */
+	{0, 1, 2, 8, 9, 10, 16, 17, 18, -1},	/* 3x3 corner */
+	{0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1},	/* 2x5 corner */
+	{8, 9, 10, 11, 12, 13, 14, 15, -1},		/* second row */
+	{16, 17, 18, 19, 20, 21, 22, 23, -1},	/* third row */
+	{24, 25, 26, 27, 28, 29, 30, 31, -1},	/* fourth row */
+	{0, 9, 18, 27, 36, 45, 54, 63, -1},		/* long diagonal */
+	{1, 10, 19, 28, 37, 46, 55, -1},		/* diagonals of 7 to 4 squares */
+	{2, 11, 20, 29, 38, 47, -1},
+	{3, 12, 21, 30, 39, -1},
+	{3, 10, 17, 24, -1}};
+
+static const char *NAMES[CLASSES] = {"edge + 2X", "corner 3x3", "corner 2x5", "row 2", "row 3", "row 4",
+									 "diagonal 8", "diagonal 7", "diagonal 6", "diagonal 5", "diagonal 4"};
+
+/* The weights table of simon_v6.c, and the factors evaluate gives its corner terms */
+static const int WEIGHTS[100] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+								 0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
+								 0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
+								 0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
+								 0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
+								 0, 5, -5, 3, 3, 3, 3, -5, 5, 0,
+								 0, 20, -5, 15, 3, 3, 15, -5, 20, 0,
+								 0, -20, -40, -5, -5, -5, -5, -40, -20, 0,
+								 0, 120, -20, 20, 5, 5, 20, -20, 120, 0,
+								 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#define CORNER_OCCUPIED (801.724 * 25)
+#define CORNER_CLOSE (382.026 * -12.5)
+/* Digits of b1, a2 and b2 in the 3x3 corner class, the squares next to its corner */
+static const int CLOSE[3] = {1, 3, 4};
+
+static int class_size[CLASSES];
+static int instances;
+static int instance_class[MAX_INSTANCES];
+static int instance_squares[MAX_INSTANCES][MAX_SQUARES];
+
+/* The eight symmetries: optionally mirror the columns, the rows and swap rows with columns */
+static int transform(int bit, int symmetry)
+{
+	int row = bit / 8, col = bit % 8, t;
+	if (symmetry & 1)
+		col = 7 - col;
+	if (symmetry & 2)
+		row = 7 - row;
+	if (symmetry & 4)
+	{
+		t = row;
+		row = col;
+		col = t;
+	}
+	return row * 8 + col;
+}
+
+static uint64_t square_set(const int *squares, int n)
+{
+	uint64_t set = 0;
+	int i;
+	for (i = 0; i < n; i++)
+		set |= 1ULL << squares[i];
+	return set;
+}
+
+static void build_instances()
+{
+	int c, s, i, j, n, squares[MAX_SQUARES];
+
+	for (c = 0; c < CLASSES; c++)
+	{
+		for (n = 0; SHAPES[c][n] != -1; n++)
+			;
+		class_size[c] = n;
+		for (s = 0; s < 8; s++)
+		{
+			for (i = 0; i < n; i++)
+				squares[i] = transform(SHAPES[c][i], s);
+			for (j = 0; j < instances; j++)
+			{
+				if (instance_class[j] == c && square_set(instance_squares[j], n) == square_set(squares, n))
+					break;
+			}
+			if (j < instances)
+				continue;
+			instance_class[instances] = c;
+			memcpy(instance_squares[instances], squares, sizeof(squares));
+			instances++;
+		}
+	}
+}
+
+static long power3(int n)
+{
+	long p = 1;
+	while (n-- > 0)
+		p *= 3;
+	return p;
+}
+
+static void write_header()
+{
+	long offset = 0;
+	int c, i, k;
+
+	printf("/* Generated by tools/gen_patterns.c, do not edit */\n\n");
+	printf("#ifndef _PATTERN_TABLES_H\n#define _PATTERN_TABLES_H\n\n");
+	printf("#define PATTERN_CLASSES %d\n", CLASSES);
+	printf("#define PATTERN_INSTANCES %d\n", instances);
+	printf("#define PATTERN_MAX_SQUARES %d\n", MAX_SQUARES);
+	printf("#define PATTERN_STAGES %d\n\n", STAGES);
+
+	printf("/* Squares in each class and where its weights start within a stage */\n");
+	printf("static const int PATTERN_CLASS_SIZE[PATTERN_CLASSES] = {");
+	for (c = 0; c < CLASSES; c++)
+		printf(c ? ", %d" : "%d", class_size[c]);
+	printf("};\nstatic const long PATTERN_CLASS_OFFSET[PATTERN_CLASSES] = {");
+	for (c = 0; c < CLASSES; c++)
+	{
+		printf(c ? ", %ld" : "%ld", offset);
+		offset += power3(class_size[c]);
+	}
+	printf("};\n#define PATTERN_STAGE_WEIGHTS %ldL\n\n", offset);
+
+	printf("/* The class of each instance and its squares as bit indices, most significant base-3 digit first */\n");
+	printf("static const int PATTERN_INSTANCE_CLASS[PATTERN_INSTANCES] = {");
+	for (i = 0; i < instances; i++)
+		printf(i ? ", %d" : "%d", instance_class[i]);
+	printf("};\nstatic const signed char PATTERN_SQUARES[PATTERN_INSTANCES][PATTERN_MAX_SQUARES] = {\n");
+	for (i = 0; i < instances; i++)
+	{
+		printf("\t{");
+		for (k = 0; k < MAX_SQUARES; k++)
+			printf(k ? ", %d" : "%d", k < class_size[instance_class[i]] ? instance_squares[i][k] : -1);
+		printf("}%s /* %s */\n", i + 1 < instances ? "," : "", NAMES[instance_class[i]]);
+	}
+	printf("};\n\n#endif\n");
+}
+
+/* Weight of one square for the side to move (digit 1) or the opponent (digit 2) */
+static double square_value(int bit, int digit, const int *coverage)
+{
+	double w = WEIGHTS[10 * (bit / 8 + 1) + bit % 8 + 1] / (double)coverage[bit];
+	return digit == 1 ? w : digit == 2 ? -w : 0.0;
+}
+
+static int write_weights(const char *path)
+{
+	FILE *out;
+	int coverage[64] = {0};
+	int c, i, k, s, n, digit, corner, digits[MAX_SQUARES];
+	long index, count;
+	double value;
+	int16_t *table;
+	int32_t header[3] = {1, STAGES, 0};
+
+	for (i = 0; i < instances; i++)
+		for (k = 0; k < class_size[instance_class[i]]; k++)
+			coverage[instance_squares[i][k]]++;
+
+	for (c = 0, count = 0; c < CLASSES; c++)
+		count += power3(class_size[c]);
+	header[2] = count;
+	table = calloc(count, sizeof(int16_t));
+	if (table == NULL)
+		return 1;
+
+	/*
+	Every instance of a class gets the same weights, so the first instance of each class stands for all of them.
+	The corner terms go to the 3x3 corner class only, which has one instance per corner.
+	*/
+	for (c = 0, count = 0; c < CLASSES; c++)
+	{
+		for (i = 0; instance_class[i] != c; i++)
+			;
+		n = class_size[c];
+		for (index = 0; index < power3(n); index++)
+		{
+			long rest = index;
+			for (k = n - 1; k >= 0; k--)
+			{
+				digits[k] = rest % 3;
+				rest /= 3;
+			}
+			value = 0;
+			for (k = 0; k < n; k++)
+				value += square_value(instance_squares[i][k], digits[k], coverage);
+			if (c == 1)
+			{
+				corner = digits[0];
+				if (corner != 0)
+					value += corner == 1 ? CORNER_OCCUPIED : -CORNER_OCCUPIED;
+				else
+				{
+					for (k = 0; k < 3; k++)
+					{
+						digit = digits[CLOSE[k]];
+						value += digit == 1 ? CORNER_CLOSE : digit == 2 ? -CORNER_CLOSE : 0;
+					}
+				}
+			}
+			if (value > 32767)
+				value = 32767;
+			if (value < -32767)
+				value = -32767;
+			table[count + index] = (int16_t)(value < 0 ? value - 0.5 : value + 0.5);
+		}
+		count += power3(n);
+	}
+
+	out = fopen(path, "wb");
+	if (out == NULL)
+		return 1;
+	fwrite("SPAT", 1, 4, out);
+	fwrite(header, sizeof(int32_t), 3, out);
+	for (s = 0; s < STAGES; s++)
+		fwrite(table, sizeof(int16_t), count, out);
+	fclose(out);
+	free(table);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	build_instances();
+	if (argc == 2 && strcmp(argv[1], "header") == 0)
+	{
+		write_header();
+		return 0;
+	}
+	if (argc == 3 && strcmp(argv[1], "weights") == 0)
+	{
+		if (write_weights(argv[2]) != 0)
+		{
+			fprintf(stderr, "Could not write %s\n", argv[2]);
+			return 1;
+		}
+		return 0;
+	}
+	fprintf(stderr, "Usage: %s header | weights <file>\n", argv[0]);
+	return 1;
+}
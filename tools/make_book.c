@@ -0,0 +1,144 @@
+/*
+ * Builds an opening book for book.c from lines of play.
+ *
+ *   make_book <lines.txt> <book file>
+ *
+ * Every line of the input is one game opening in the usual notation, a column a-h and a row 1-8 per move from the
+ * start position with black to move, e.g. f5d6c3d3c4. Spaces are ignored, and so is everything after a '#'. The
+ * book gets the position before each move with that move; where lines share a position the earliest line wins.
+ *
+ * Compile with: cc -O2 -I. -o make_book tools/make_book.c book.c bitboard.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "../bitboard.h"
+#include "../book.h"
+
+typedef struct entry
+{
+	book_record record;
+	long order;
+} entry;
+
+static entry *entries;
+static long count, capacity;
+
+static int compare(const void *a, const void *b)
+{
+	const entry *x = a, *y = b;
+	if (x->record.key != y->record.key)
+		return x->record.key < y->record.key ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static int add(uint64_t own, uint64_t opp, int bit)
+{
+	uint64_t key;
+	int symmetry = book_canonical(own, opp, &key);
+
+	if (count == capacity)
+	{
+		capacity = capacity ? 2 * capacity : 1024;
+		entries = realloc(entries, capacity * sizeof(entry));
+		if (entries == NULL)
+			return 1;
+	}
+	memset(&entries[count], 0, sizeof(entry));
+	entries[count].record.key = key;
+	entries[count].record.move = bb_first(bb_transform(BB_BIT(bit), symmetry));
+	entries[count].order = count;
+	count++;
+	return 0;
+}
+
+static int read_line(char *line, int number)
+{
+	/* d4 and e5 white, d5 and e4 black, as in initialise_board */
+	uint64_t black = BB_BIT(28) | BB_BIT(35), white = BB_BIT(27) | BB_BIT(36);
+	uint64_t *own = &black, *opp = &white, *t, flips;
+	char *c;
+	int bit;
+
+	for (c = line; *c && *c != '#'; c++)
+	{
+		if (isspace((unsigned char)*c))
+			continue;
+		if (tolower((unsigned char)c[0]) < 'a' || tolower((unsigned char)c[0]) > 'h' || c[1] < '1' || c[1] > '8')
+		{
+			fprintf(stderr, "Line %d: cannot read move at \"%s\"\n", number, c);
+			return 1;
+		}
+		bit = 8 * (c[1] - '1') + tolower((unsigned char)c[0]) - 'a';
+		c++;
+		// A side with no move passes
+		if (bb_moves(*own, *opp) == 0)
+		{
+			t = own;
+			own = opp;
+			opp = t;
+		}
+		flips = bb_flips(bit, *own, *opp);
+		if (!(bb_moves(*own, *opp) & BB_BIT(bit)))
+		{
+			fprintf(stderr, "Line %d: illegal move %c%c\n", number, c[-1], c[0]);
+			return 1;
+		}
+		if (add(*own, *opp, bit) != 0)
+			return 1;
+		*own |= flips | BB_BIT(bit);
+		*opp ^= flips;
+		t = own;
+		own = opp;
+		opp = t;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *in, *out;
+	char line[1024];
+	uint32_t version = 1;
+	uint64_t written;
+	long i;
+	int number = 0, errors = 0;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s <lines.txt> <book file>\n", argv[0]);
+		return 1;
+	}
+	in = fopen(argv[1], "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in) != NULL)
+		errors += read_line(line, ++number);
+	fclose(in);
+
+	qsort(entries, count, sizeof(entry), compare);
+	for (i = 0, written = 0; i < count; i++)
+		if (i == 0 || entries[i].record.key != entries[i - 1].record.key)
+			entries[written++] = entries[i];
+
+	out = fopen(argv[2], "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[2]);
+		return 1;
+	}
+	fwrite("SBOK", 1, 4, out);
+	fwrite(&version, sizeof(version), 1, out);
+	fwrite(&written, sizeof(written), 1, out);
+	for (i = 0; i < (long)written; i++)
+		fwrite(&entries[i].record, sizeof(book_record), 1, out);
+	fclose(out);
+	printf("%llu positions from %d lines, %d lines with errors\n", (unsigned long long)written, number, errors);
+	return errors ? 1 : 0;
+}
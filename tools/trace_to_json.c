@@ -0,0 +1,109 @@
+/*
+ * Turns the event traces of the ranks (trace.h) into one Chrome trace.
+ *
+ *   trace_to_json <trace files...> > trace.json
+ *
+ * Every rank becomes a process of its own, with its searches, jobs and idle waits as spans and the jobs and
+ * results it sends and receives as instants, so that load imbalance shows up as gaps on the timeline. The file
+ * opens in chrome://tracing or ui.perfetto.dev. The ranks' clocks are lined up at the moment they opened their
+ * traces.
+ *
+ * Compile with: cc -O2 -I. -o trace_to_json tools/trace_to_json.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../trace.h"
+
+/* Names of the events by number, spans under the name of their start */
+static const char *NAMES[] = {"", "search", "search", "job", "job", "idle", "idle", "job sent", "result received",
+							  "result sent"};
+
+static int first = 1;
+
+static void emit(int rank, const char *name, const char *phase, double time, const char *arg, int value)
+{
+	printf("%s\n{\"name\": \"%s\", \"ph\": \"%s\", \"pid\": %d, \"tid\": 0, \"ts\": %.3f", first ? "" : ",", name,
+		   phase, rank, time * 1e6);
+	if (phase[0] == 'i')
+		printf(", \"s\": \"t\"");
+	if (arg != NULL)
+		printf(", \"args\": {\"%s\": %d}", arg, value);
+	printf("}");
+	first = 0;
+}
+
+static int convert(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	char magic[4];
+	int32_t header[2];
+	trace_record record;
+
+	if (in == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return 1;
+	}
+	if (fread(magic, 1, 4, in) != 4 || memcmp(magic, "STRC", 4) != 0 || fread(header, sizeof(int32_t), 2, in) != 2 ||
+		header[0] != 1)
+	{
+		fprintf(stderr, "%s is not a trace\n", path);
+		fclose(in);
+		return 1;
+	}
+	printf("%s\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}}",
+		   first ? "" : ",", header[1], header[1]);
+	first = 0;
+
+	while (fread(&record, sizeof(trace_record), 1, in) == 1)
+	{
+		if (record.event < TRACE_SEARCH_START || record.event > TRACE_RESULT_SENT)
+			continue;
+		switch (record.event)
+		{
+		case TRACE_SEARCH_START:
+			emit(header[1], NAMES[record.event], "B", record.time, "mover", record.arg);
+			break;
+		case TRACE_JOB_START:
+			emit(header[1], NAMES[record.event], "B", record.time, "id", record.arg);
+			break;
+		case TRACE_IDLE_START:
+			emit(header[1], NAMES[record.event], "B", record.time, NULL, 0);
+			break;
+		case TRACE_JOB_END:
+			emit(header[1], NAMES[record.event], "E", record.time, "status", record.arg);
+			break;
+		case TRACE_SEARCH_END:
+		case TRACE_IDLE_END:
+			emit(header[1], NAMES[record.event], "E", record.time, NULL, 0);
+			break;
+		case TRACE_JOB_SENT:
+		case TRACE_RESULT_RECEIVED:
+			emit(header[1], NAMES[record.event], "i", record.time, "worker", record.arg);
+			break;
+		default:
+			emit(header[1], NAMES[record.event], "i", record.time, "id", record.arg);
+		}
+	}
+	fclose(in);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, failed = 0;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: trace_to_json <trace files...>\n");
+		return 1;
+	}
+	printf("{\"traceEvents\": [");
+	for (i = 1; i < argc; i++)
+		failed |= convert(argv[i]);
+	printf("\n]}\n");
+	return failed;
+}
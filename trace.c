@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "comms.h"
+#include "trace.h"
+
+/* Events kept in memory before they have to be written out */
+#define TRACE_CAPACITY 65536
+
+static FILE *file;
+static trace_record *records;
+static int count;
+static double start;
+
+static double trace_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Starts a trace into the file at path. Times are counted from now, so
+ * ranks that open their traces together share a time line.
+ */
+int trace_open(const char *path, int rank)
+{
+	int32_t header[2] = {1, rank};
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+		return FAILURE;
+	records = (trace_record *)malloc(TRACE_CAPACITY * sizeof(trace_record));
+	if (records == NULL || fwrite("STRC", 1, 4, file) != 4 || fwrite(header, sizeof(int32_t), 2, file) != 2)
+	{
+		trace_close();
+		return FAILURE;
+	}
+	count = 0;
+	start = trace_time();
+	return SUCCESS;
+}
+
+/**
+ * Records an event, or does nothing if there is no trace open. Only the
+ * main thread of a rank may record.
+ */
+void trace_event(int event, int arg)
+{
+	if (records == NULL)
+		return;
+	if (count == TRACE_CAPACITY)
+		trace_flush();
+	records[count].time = trace_time() - start;
+	records[count].event = event;
+	records[count].arg = arg;
+	count++;
+}
+
+/* Writes out the events recorded so far */
+void trace_flush()
+{
+	if (records == NULL || count == 0)
+		return;
+	fwrite(records, sizeof(trace_record), count, file);
+	fflush(file);
+	count = 0;
+}
+
+void trace_close()
+{
+	trace_flush();
+	free(records);
+	records = NULL;
+	if (file != NULL)
+		fclose(file);
+	file = NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Event trace of one rank: its main thread records timestamped events in
+ * memory, and they are only written to the file between moves or when the
+ * buffer fills, so the search never waits on the file system.
+ * tools/trace_to_json.c turns the files of all ranks into a Chrome trace.
+ *
+ * A trace file is the four bytes "STRC", int32 version (1) and rank, then
+ * the trace_records, all in the byte order of the machine.
+ */
+
+/* Events, the ones ending in _START and _END open and close a span */
+#define TRACE_SEARCH_START 1	/* a board to search has arrived, arg is the side to move */
+#define TRACE_SEARCH_END 2
+#define TRACE_JOB_START 3		/* arg is the id of the job */
+#define TRACE_JOB_END 4			/* arg is the status of its result */
+#define TRACE_IDLE_START 5		/* waiting on another rank */
+#define TRACE_IDLE_END 6
+#define TRACE_JOB_SENT 7		/* at rank 0, arg is the worker */
+#define TRACE_RESULT_RECEIVED 8 /* at rank 0, arg is the worker */
+#define TRACE_RESULT_SENT 9		/* arg is the id of the job */
+
+typedef struct trace_record
+{
+	double time; /* seconds since trace_open */
+	int32_t event;
+	int32_t arg;
+} trace_record;
+
+int trace_open(const char *path, int rank);
+void trace_event(int event, int arg);
+void trace_flush();
+void trace_close();
+
+#endif
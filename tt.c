@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "comms.h"
+#include "tt.h"
+
+/* One bucket fills a 64-byte cache line */
+#define TT_BUCKET_ENTRIES 5
+
+typedef struct tt_bucket
+{
+	tt_entry entries[TT_BUCKET_ENTRIES];
+	uint32_t pad;
+} tt_bucket;
+
+uint64_t zobrist[3][64];
+uint64_t zobrist_side[3];
+
+static tt_bucket *table;
+static uint64_t bucket_mask;
+static uint8_t generation;
+
+/* The slice of the distributed table this rank owns, exposed to every rank through window */
+static tt_bucket *shared_table;
+static uint64_t shared_mask;
+static MPI_Win window;
+static int ranks;
+
+/*
+ * The lock of an entry is stored XORed with its data, so that an entry torn by two threads of a rank writing it
+ * at once no longer matches its key and is ignored. The generation is left out, probes update it in place.
+ */
+static inline uint32_t entry_check(const tt_entry *entry)
+{
+	return (uint32_t)entry->score ^ ((uint32_t)(uint8_t)entry->depth | (uint32_t)entry->bound << 8 |
+									 (uint32_t)entry->move << 16);
+}
+
+/* splitmix64, seeded the same on every rank so that all ranks agree on the keys */
+static uint64_t next_random(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+void zobrist_init()
+{
+	uint64_t state = 0x4f74686c6c6fULL;
+	int colour, bit;
+	for (colour = 0; colour < 3; colour++)
+	{
+		for (bit = 0; bit < 64; bit++)
+			zobrist[colour][bit] = next_random(&state);
+		zobrist_side[colour] = next_random(&state);
+	}
+}
+
+/**
+ * Computes the key of a position from scratch, discs is indexed by colour.
+ * The search keeps keys up to date incrementally and only uses this at the root.
+ */
+uint64_t zobrist_key(const uint64_t *discs)
+{
+	uint64_t key = 0;
+	uint64_t b;
+	int colour;
+	for (colour = 1; colour < 3; colour++)
+		for (b = discs[colour]; b; b &= b - 1)
+			key ^= zobrist[colour][__builtin_ctzll(b)];
+	return key;
+}
+
+/**
+ * Allocates a table of the largest power of two number of buckets that fits in megabytes.
+ * The table is kept for the whole game.
+ */
+int tt_init(int megabytes)
+{
+	uint64_t buckets = 1;
+	uint64_t limit = (uint64_t)megabytes * 1024 * 1024 / sizeof(tt_bucket);
+
+	if (limit == 0)
+		return FAILURE;
+	while (buckets * 2 <= limit)
+		buckets *= 2;
+
+	if (posix_memalign((void **)&table, sizeof(tt_bucket), buckets * sizeof(tt_bucket)) != 0)
+	{
+		table = NULL;
+		return FAILURE;
+	}
+	memset(table, 0, buckets * sizeof(tt_bucket));
+	bucket_mask = buckets - 1;
+	generation = 0;
+	return SUCCESS;
+}
+
+/* Empties the table, for searches that must not see what earlier ones found */
+void tt_clear()
+{
+	if (table != NULL)
+		memset(table, 0, (bucket_mask + 1) * sizeof(tt_bucket));
+}
+
+void tt_free()
+{
+	free(table);
+	table = NULL;
+}
+
+/**
+ * Called once per gen_move, so that entries left over from earlier moves are replaced first
+ */
+void tt_new_search()
+{
+	generation++;
+}
+
+/* Returns which entry of bucket holds lock, -1 if none does */
+static int find_entry(tt_bucket *bucket, uint32_t lock)
+{
+	tt_entry *entry;
+	int i;
+
+	for (i = 0; i < TT_BUCKET_ENTRIES; i++)
+	{
+		entry = &bucket->entries[i];
+		if ((entry->lock ^ entry_check(entry)) == lock && entry->depth > 0)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Returns which entry of bucket a result for lock goes into: the entry already holding lock, otherwise the
+ * shallowest one, with entries from earlier moves counting as shallower than any from this move
+ */
+static int replaced_entry(tt_bucket *bucket, uint32_t lock)
+{
+	tt_entry *entry;
+	int i, value, worst, replace;
+
+	replace = 0;
+	worst = 1 << 30;
+	for (i = 0; i < TT_BUCKET_ENTRIES; i++)
+	{
+		entry = &bucket->entries[i];
+		if ((entry->lock ^ entry_check(entry)) == lock)
+			return i;
+		value = entry->depth - (entry->generation == generation ? 0 : 128);
+		if (value < worst)
+		{
+			worst = value;
+			replace = i;
+		}
+	}
+	return replace;
+}
+
+static void fill_entry(tt_entry *entry, uint32_t lock, int depth, int bound, int score, int move)
+{
+	entry->score = score;
+	entry->depth = depth;
+	entry->bound = bound;
+	entry->move = move;
+	entry->generation = generation;
+	entry->lock = lock ^ entry_check(entry);
+}
+
+/**
+ * Copies the entry for key into entry and returns 1 if the table holds one, otherwise returns 0
+ */
+int tt_probe(uint64_t key, tt_entry *entry)
+{
+	tt_bucket *bucket;
+	int i;
+
+	if (table == NULL)
+		return 0;
+	bucket = &table[key & bucket_mask];
+	i = find_entry(bucket, key >> 32);
+	if (i == -1)
+		return 0;
+	*entry = bucket->entries[i];
+	bucket->entries[i].generation = generation;
+	return 1;
+}
+
+/**
+ * Stores a search result. An existing entry for the same key is overwritten, otherwise the entry replaced is
+ * the shallowest one, with entries from earlier moves counting as shallower than any from this move.
+ * The threads of a rank store without locking, see entry_check.
+ */
+void tt_store(uint64_t key, int depth, int bound, int score, int move)
+{
+	tt_bucket *bucket;
+	uint32_t lock = key >> 32;
+
+	if (table == NULL)
+		return;
+	bucket = &table[key & bucket_mask];
+	fill_entry(&bucket->entries[replaced_entry(bucket, lock)], lock, depth, bound, score, move);
+}
+
+/**
+ * Joins the distributed table, which every rank of MPI_COMM_WORLD has to call at once: each rank owns a slice of
+ * the largest power of two number of buckets that fits in megabytes, and the key of a position decides which
+ * rank's slice holds it. The slices are read and written with one-sided MPI calls alone, so the owner of an entry
+ * does nothing to serve it. Returns FAILURE on every rank if any rank could not allocate its slice.
+ */
+int tt_share(int megabytes)
+{
+	uint64_t buckets = 1;
+	uint64_t limit = (uint64_t)megabytes * 1024 * 1024 / sizeof(tt_bucket);
+	int failed, any;
+
+	// Every rank has the same megabytes, so they all fail here together
+	if (limit == 0)
+		return FAILURE;
+	while (buckets * 2 <= limit)
+		buckets *= 2;
+	MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+	failed = MPI_Win_allocate(buckets * sizeof(tt_bucket), sizeof(uint32_t), MPI_INFO_NULL, MPI_COMM_WORLD,
+							  &shared_table, &window) != MPI_SUCCESS;
+	MPI_Allreduce(&failed, &any, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+	if (any)
+	{
+		if (!failed)
+			MPI_Win_free(&window);
+		shared_table = NULL;
+		return FAILURE;
+	}
+	memset(shared_table, 0, buckets * sizeof(tt_bucket));
+	shared_mask = buckets - 1;
+	// No rank may read a slice before its owner has cleared it
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+	return SUCCESS;
+}
+
+/**
+ * Leaves the distributed table, again on every rank at once
+ */
+void tt_unshare()
+{
+	if (shared_table == NULL)
+		return;
+	MPI_Win_unlock_all(window);
+	MPI_Win_free(&window);
+	shared_table = NULL;
+}
+
+/* The rank owning key, from the upper half of the key as the bucket comes from the lower */
+static int owner(uint64_t key)
+{
+	return (int)(((key >> 32) * (uint64_t)ranks) >> 32);
+}
+
+/*
+Reads the bucket of key from the rank owning it into bucket, returns its displacement in the window of that rank.
+The read is an accumulate with MPI_NO_OP on the same basic type tt_shared_store writes with, so that it is atomic
+word by word against a store by another rank rather than a conflicting access, which MPI leaves undefined.
+*/
+static MPI_Aint fetch_bucket(uint64_t key, tt_bucket *bucket)
+{
+	MPI_Aint displacement = (MPI_Aint)(key & shared_mask) * (sizeof(tt_bucket) / sizeof(uint32_t));
+	int words = sizeof(tt_bucket) / sizeof(uint32_t);
+
+	MPI_Get_accumulate(NULL, 0, MPI_UINT32_T, bucket, words, MPI_UINT32_T, owner(key), displacement, words,
+					   MPI_UINT32_T, MPI_NO_OP, window);
+	MPI_Win_flush(owner(key), window);
+	return displacement;
+}
+
+/**
+ * Like tt_probe for the distributed table, except that entry is left alone unless 1 is returned. Each word is read
+ * whole, see fetch_bucket, but an entry read while another rank writes it may mix words of the old and the new one,
+ * which then fails its check like one torn by two threads. Only the main thread of a rank may call this or
+ * tt_shared_store, as they make MPI calls.
+ */
+int tt_shared_probe(uint64_t key, tt_entry *entry)
+{
+	tt_bucket bucket;
+	int i;
+
+	if (shared_table == NULL)
+		return 0;
+	fetch_bucket(key, &bucket);
+	i = find_entry(&bucket, key >> 32);
+	if (i == -1)
+		return 0;
+	*entry = bucket.entries[i];
+	return 1;
+}
+
+/**
+ * Like tt_store for the distributed table: the bucket is read from its owner to choose the entry to replace, which
+ * is then written with MPI_Accumulate so that each word of it lands whole
+ */
+void tt_shared_store(uint64_t key, int depth, int bound, int score, int move)
+{
+	tt_bucket bucket;
+	tt_entry entry;
+	uint32_t lock = key >> 32;
+	MPI_Aint displacement;
+	int i;
+
+	if (shared_table == NULL)
+		return;
+	displacement = fetch_bucket(key, &bucket);
+	i = replaced_entry(&bucket, lock);
+	fill_entry(&entry, lock, depth, bound, score, move);
+	MPI_Accumulate(&entry, sizeof(tt_entry) / sizeof(uint32_t), MPI_UINT32_T, owner(key),
+				   displacement + i * (sizeof(tt_entry) / sizeof(uint32_t)), sizeof(tt_entry) / sizeof(uint32_t),
+				   MPI_UINT32_T, MPI_REPLACE, window);
+	MPI_Win_flush(owner(key), window);
+}
@@ -0,0 +1,40 @@
+#ifndef _TT_H
+#define _TT_H
+
+#include <stdint.h>
+
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+
+/* Random keys per colour and bit, indexed like position.discs */
+extern uint64_t zobrist[3][64];
+/* XORed into a key for the colour to move */
+extern uint64_t zobrist_side[3];
+
+typedef struct tt_entry
+{
+	uint32_t lock;
+	int32_t score;
+	int8_t depth;
+	uint8_t bound;
+	uint8_t move;
+	uint8_t generation;
+} tt_entry;
+
+void zobrist_init();
+uint64_t zobrist_key(const uint64_t *discs);
+
+int tt_init(int megabytes);
+void tt_free();
+void tt_clear();
+void tt_new_search();
+int tt_probe(uint64_t key, tt_entry *entry);
+void tt_store(uint64_t key, int depth, int bound, int score, int move);
+
+int tt_share(int megabytes);
+void tt_unshare();
+int tt_shared_probe(uint64_t key, tt_entry *entry);
+void tt_shared_store(uint64_t key, int depth, int bound, int score, int move);
+
+#endif